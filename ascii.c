@@ -0,0 +1,197 @@
+
+/*
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+  SPDX-License-Identifier: MIT
+  Copyright (c) 2018 Rafa Garcia <rafagarcia77@gmail.com>.
+  Permission is hereby  granted, free of charge, to any  person obtaining a copy
+  of this software and associated  documentation files (the "Software"), to deal
+  in the Software  without restriction, including without  limitation the rights
+  to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+  copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+  IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+  FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+  AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+  LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "ascii.h"
+
+#if defined( __AVX2__ )
+#include <immintrin.h>
+#elif defined( __SSE2__ ) || defined( _M_X64 )
+#include <emmintrin.h>
+#define ASCII_SSE2
+#endif
+
+enum {
+    S = ASCII_SPACE,
+    P = ASCII_PRINT,
+    D = ASCII_DIGIT,
+    C = ASCII_CTRL
+};
+
+/* Classes of each byte. */
+unsigned char const ascii_table[ 256 ] = {
+    C, C, C, C, C, C, C, C, C, S|C, S|C, S|C, S|C, S|C, C, C,
+    C, C, C, C, C, C, C, C, C, C, C, C, C, C, C, C,
+    S|P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P,
+    P|D, P|D, P|D, P|D, P|D, P|D, P|D, P|D, P|D, P|D, P, P, P, P, P, P,
+    P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P,
+    P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P,
+    P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P,
+    P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, C,
+};
+
+#if defined( __AVX2__ )
+
+/** Number of characters processed at once. */
+enum { block = 32 };
+
+/** Get a bit mask with the characters of a block that are of a class.
+  * @param buf Block of characters.
+  * @param cls A single class.
+  * @return Bit i is set if the character i is of the class. */
+static unsigned matches( char const* buf, int cls ) {
+    __m256i const v = _mm256_loadu_si256( (__m256i const*)buf );
+    __m256i m;
+    switch( cls ) {
+        case ASCII_SPACE: {
+            __m256i const x = _mm256_sub_epi8( v, _mm256_set1_epi8( '\t' ) );
+            m = _mm256_or_si256( _mm256_cmpeq_epi8( v, _mm256_set1_epi8( ' ' ) ),
+                _mm256_cmpeq_epi8( _mm256_min_epu8( x, _mm256_set1_epi8( 4 ) ), x ) );
+            break;
+        }
+        case ASCII_PRINT: {
+            __m256i const x = _mm256_sub_epi8( v, _mm256_set1_epi8( ' ' ) );
+            m = _mm256_cmpeq_epi8( _mm256_min_epu8( x, _mm256_set1_epi8( '~' - ' ' ) ), x );
+            break;
+        }
+        case ASCII_DIGIT: {
+            __m256i const x = _mm256_sub_epi8( v, _mm256_set1_epi8( '0' ) );
+            m = _mm256_cmpeq_epi8( _mm256_min_epu8( x, _mm256_set1_epi8( 9 ) ), x );
+            break;
+        }
+        default: {
+            m = _mm256_or_si256( _mm256_cmpeq_epi8( v, _mm256_set1_epi8( 0x7F ) ),
+                _mm256_cmpeq_epi8( _mm256_min_epu8( v, _mm256_set1_epi8( 0x1F ) ), v ) );
+            break;
+        }
+    }
+    return (unsigned)_mm256_movemask_epi8( m );
+}
+
+#elif defined( ASCII_SSE2 )
+
+/** Number of characters processed at once. */
+enum { block = 16 };
+
+/** Get a bit mask with the characters of a block that are of a class.
+  * @param buf Block of characters.
+  * @param cls A single class.
+  * @return Bit i is set if the character i is of the class. */
+static unsigned matches( char const* buf, int cls ) {
+    __m128i const v = _mm_loadu_si128( (__m128i const*)buf );
+    __m128i m;
+    switch( cls ) {
+        case ASCII_SPACE: {
+            __m128i const x = _mm_sub_epi8( v, _mm_set1_epi8( '\t' ) );
+            m = _mm_or_si128( _mm_cmpeq_epi8( v, _mm_set1_epi8( ' ' ) ),
+                _mm_cmpeq_epi8( _mm_min_epu8( x, _mm_set1_epi8( 4 ) ), x ) );
+            break;
+        }
+        case ASCII_PRINT: {
+            __m128i const x = _mm_sub_epi8( v, _mm_set1_epi8( ' ' ) );
+            m = _mm_cmpeq_epi8( _mm_min_epu8( x, _mm_set1_epi8( '~' - ' ' ) ), x );
+            break;
+        }
+        case ASCII_DIGIT: {
+            __m128i const x = _mm_sub_epi8( v, _mm_set1_epi8( '0' ) );
+            m = _mm_cmpeq_epi8( _mm_min_epu8( x, _mm_set1_epi8( 9 ) ), x );
+            break;
+        }
+        default: {
+            m = _mm_or_si128( _mm_cmpeq_epi8( v, _mm_set1_epi8( 0x7F ) ),
+                _mm_cmpeq_epi8( _mm_min_epu8( v, _mm_set1_epi8( 0x1F ) ), v ) );
+            break;
+        }
+    }
+    return (unsigned)_mm_movemask_epi8( m );
+}
+
+#endif
+
+#if defined( __AVX2__ ) || defined( ASCII_SSE2 )
+
+/** Check if a set of classes can be processed with vectors.
+  * @param cls Set of classes.
+  * @return Non-zero if it is a single class. */
+static int vectorizable( int cls ) {
+    return 0 != cls && 0 == ( cls & ( cls - 1 ) );
+}
+
+#endif
+
+/** Scan forward an array while the characters are or are not of a set of classes.
+  * @param buf  Array of characters.
+  * @param len  Length of the array.
+  * @param cls  Set of classes.
+  * @param want Non-zero to scan while they are of the classes.
+  * @return Position of the first character that stops the scan or len. */
+static int forward( char const* buf, int len, int cls, int want ) {
+    int i = 0;
+#if defined( __AVX2__ ) || defined( ASCII_SSE2 )
+    if( vectorizable( cls ) ) {
+        unsigned const all = 32 == block ? 0xFFFFFFFFu : 0xFFFFu;
+        unsigned const stop = want ? all : 0;
+        for( ; i + block <= len && stop == matches( buf + i, cls ); i += block );
+    }
+#endif
+    for( ; i < len && !ascii_is( buf[i], cls ) == !want; ++i );
+    return i;
+}
+
+/** Scan backward an array while the characters are or are not of a set of classes.
+  * @param buf  Array of characters.
+  * @param len  Length of the array.
+  * @param cls  Set of classes.
+  * @param want Non-zero to scan while they are of the classes.
+  * @return Number of characters scanned from the end. */
+static int backward( char const* buf, int len, int cls, int want ) {
+    int i = len;
+#if defined( __AVX2__ ) || defined( ASCII_SSE2 )
+    if( vectorizable( cls ) ) {
+        unsigned const all = 32 == block ? 0xFFFFFFFFu : 0xFFFFu;
+        unsigned const stop = want ? all : 0;
+        for( ; i - block >= 0 && stop == matches( buf + i - block, cls ); i -= block );
+    }
+#endif
+    for( ; i > 0 && !ascii_is( buf[i-1], cls ) == !want; --i );
+    return len - i;
+}
+
+/* Get the number of characters at the start of an array of a set of classes. */
+int ascii_span( char const* buf, int len, int cls ) {
+    return forward( buf, len, cls, 1 );
+}
+
+/* Get the number of characters at the start of an array not of a set of classes. */
+int ascii_cspan( char const* buf, int len, int cls ) {
+    return forward( buf, len, cls, 0 );
+}
+
+/* Get the number of characters at the end of an array of a set of classes. */
+int ascii_rspan( char const* buf, int len, int cls ) {
+    return backward( buf, len, cls, 1 );
+}
+
+/* Get the number of characters at the end of an array not of a set of classes. */
+int ascii_rcspan( char const* buf, int len, int cls ) {
+    return backward( buf, len, cls, 0 );
+}
+
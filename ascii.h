@@ -0,0 +1,85 @@
+
+/*
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+  SPDX-License-Identifier: MIT
+  Copyright (c) 2018 Rafa Garcia <rafagarcia77@gmail.com>.
+  Permission is hereby  granted, free of charge, to any  person obtaining a copy
+  of this software and associated  documentation files (the "Software"), to deal
+  in the Software  without restriction, including without  limitation the rights
+  to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+  copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+  IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+  FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+  AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+  LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#ifndef ASCII_H
+#define ASCII_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/** Classes of ASCII characters. They do not depend on the locale. */
+enum ascii_class {
+    ASCII_SPACE = 1, /**< Space, \t, \n, \v, \f and \r.    */
+    ASCII_PRINT = 2, /**< Printable characters from ' ' to '~'. */
+    ASCII_DIGIT = 4, /**< Decimal digits.                      */
+    ASCII_CTRL  = 8, /**< Control characters and DEL.          */
+};
+
+/** Classes of each byte. The bytes with the high bit set have no class. */
+extern unsigned char const ascii_table[ 256 ];
+
+/** Check if a character belongs to any of a set of classes.
+  * @param c   The character.
+  * @param cls Set of classes, see enum ascii_class. */
+#define ascii_is( c, cls ) ( ascii_table[ (unsigned char)(c) ] & (cls) )
+
+/*
+ * The following functions scan an array of characters and they are
+ * vectorized with AVX2 or SSE2 if the compiler is targeting them.
+ * The vectorized paths are used when cls is a single class.
+ */
+
+/** Get the number of characters at the start of an array of a set of classes.
+  * @param buf Array of characters.
+  * @param len Length of the array.
+  * @param cls Set of classes, see enum ascii_class.
+  * @return The position of the first character that is not of the classes
+  *         or len if there is not. */
+int ascii_span( char const* buf, int len, int cls );
+
+/** Get the number of characters at the start of an array not of a set of classes.
+  * @param buf Array of characters.
+  * @param len Length of the array.
+  * @param cls Set of classes, see enum ascii_class.
+  * @return The position of the first character that is of the classes
+  *         or len if there is not. */
+int ascii_cspan( char const* buf, int len, int cls );
+
+/** Get the number of characters at the end of an array of a set of classes.
+  * @param buf Array of characters.
+  * @param len Length of the array.
+  * @param cls Set of classes, see enum ascii_class. */
+int ascii_rspan( char const* buf, int len, int cls );
+
+/** Get the number of characters at the end of an array not of a set of classes.
+  * @param buf Array of characters.
+  * @param len Length of the array.
+  * @param cls Set of classes, see enum ascii_class. */
+int ascii_rcspan( char const* buf, int len, int cls );
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* ASCII_H */
+
@@ -20,23 +20,24 @@
   SOFTWARE.
 */
 
-#include <ctype.h>
 #include <stdio.h>
+#include <string.h>
+#include "ascii.h"
 
 /**  Search the next non-space or null character.
-  * @param p Pointer to first character.
+  * @param p   Pointer to first character.
+  * @param end Pointer to the null character that ends the string.
   * @return  Pointer to the found character. */
-static char* skipspace( char* p ) {
-    for( ; '\0' != *p && isspace( *p ); ++p );
-    return p;
+static char* skipspace( char* p, char const* end ) {
+    return p + ascii_span( p, end - p, ASCII_SPACE );
 }
 
 /** Search the next space or null character.
-  * @param p Pointer to first character.
+  * @param p   Pointer to first character.
+  * @param end Pointer to the null character that ends the string.
   * @return  Pointer to the found character. */
-static char* skipnonspace( char* p ) {
-    for( ; '\0' != *p && !isspace( *p ); ++p );
-    return p;
+static char* skipnonspace( char* p, char const* end ) {
+    return p + ascii_cspan( p, end - p, ASCII_SPACE );
 }
 
 static int getesc( int ch ) {
@@ -77,8 +78,9 @@ static char* parsearg( char* str ) {
 
 /* Parse Command Line ARGuments */
 int clarg( char** argv, int max, char* line ) {
+    char const* const end = line + strlen( line );
     for( int i = 0; i < max; ++i ) {
-        line = skipspace( line );
+        line = skipspace( line, end );
         if( '\0' == *line )
             return i;
         if( '\"' == *line ) {
@@ -89,7 +91,7 @@ int clarg( char** argv, int max, char* line ) {
         }
         else {
             argv[i] = line;
-            line = skipnonspace( line );
+            line = skipnonspace( line, end );
             if( '\0' == *line )
                 return i + 1;
             *line = '\0';
@@ -98,3 +100,22 @@ int clarg( char** argv, int max, char* line ) {
     }
     return -1;
 }
+
+/* Find an argument of a command line without modifying it. */
+int clarg_find( char const* line, int len, int* pos, int* arg ) {
+    int i = *pos + ascii_span( line + *pos, len - *pos, ASCII_SPACE );
+    *pos = i;
+    if( len == i || '\0' == line[i] )
+        return -1;
+    if( '\"' != line[i] ) {
+        *arg = i;
+        *pos = i + ascii_cspan( line + i, len - i, ASCII_SPACE );
+        return *pos - i;
+    }
+    *arg = ++i;
+    for( ; i < len && ' ' <= (unsigned char)line[i] && '\"' != line[i]; ++i )
+        if( '\\' == line[i] && i + 1 < len )
+            ++i;
+    *pos = i + ( i < len && '\"' == line[i] );
+    return i - *arg;
+}
@@ -35,6 +35,19 @@ extern "C" {
             On error, negative value. */
 int clarg( char** argv, int max, char* line );
 
+/** Find an argument of a command line without modifying it.
+  * The arguments are delimited like clarg() does: they are separated by
+  * spaces and an argument that starts with a quotation mark ends at the
+  * next one that is not escaped. The escape sequences are not replaced.
+  * @param line The command line. It does not need to be null-terminated.
+  * @param len  Length of the command line.
+  * @param pos  Position where the search starts. It is set just after the
+  *             argument found, after its quotation mark if it has one.
+  * @param arg  Destination of the position of the first character of the
+  *             argument found, after the quotation mark if it is quoted.
+  * @return The length of the argument found or -1 if there are not more. */
+int clarg_find( char const* line, int len, int* pos, int* arg );
+
 #ifdef	__cplusplus
 }
 #endif
@@ -0,0 +1,274 @@
+
+/*
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+  SPDX-License-Identifier: MIT
+  Copyright (c) 2018 Rafa Garcia <rafagarcia77@gmail.com>.
+  Permission is hereby  granted, free of charge, to any  person obtaining a copy
+  of this software and associated  documentation files (the "Software"), to deal
+  in the Software  without restriction, including without  limitation the rights
+  to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+  copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+  IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+  FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+  AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+  LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "ecma48.h"
+#include "ascii.h"
+
+/*
+ * Parser of escape and control sequences of ECMA-48 (ANSI X3.64) driven by a
+ * state transition table, as described by Paul Williams for the DEC VT500.
+ * Each received byte is mapped to a class and each pair of state and class is
+ * mapped to the next state and an action. Control strings (OSC, DCS, SOS, PM
+ * and APC) are skipped until they are terminated by BEL, ST or CAN.
+ */
+
+/** Classes of bytes. */
+enum class {
+    CT, /**< C0 control characters.          */
+    BL, /**< BEL, terminates control strings. */
+    CN, /**< CAN and SUB, cancel a sequence.  */
+    ES, /**< ESC, starts a sequence.          */
+    IN, /**< Intermediate bytes.              */
+    DI, /**< Digits.                          */
+    SP, /**< Parameter separators ':' ';'.    */
+    PR, /**< Private parameter bytes <=>?.    */
+    LB, /**< '[' starts a control sequence.   */
+    RB, /**< ']' starts an OSC string.        */
+    SO, /**< 'O' starts a SS3 sequence.       */
+    ST, /**< 'P' 'X' '^' '_' start strings.   */
+    FI, /**< Other final bytes.               */
+    DE, /**< DEL.                             */
+    HI, /**< Bytes with the high bit set.     */
+    CLASSES
+};
+
+/** Class of each byte. */
+static unsigned char const classes[ 256 ] = {
+    CT, CT, CT, CT, CT, CT, CT, BL, CT, CT, CT, CT, CT, CT, CT, CT, /* 0_ */
+    CT, CT, CT, CT, CT, CT, CT, CT, CN, CT, CN, ES, CT, CT, CT, CT, /* 1_ */
+    IN, IN, IN, IN, IN, IN, IN, IN, IN, IN, IN, IN, IN, IN, IN, IN, /* 2_ */
+    DI, DI, DI, DI, DI, DI, DI, DI, DI, DI, SP, SP, PR, PR, PR, PR, /* 3_ */
+    FI, FI, FI, FI, FI, FI, FI, FI, FI, FI, FI, FI, FI, FI, FI, SO, /* 4_ */
+    ST, FI, FI, FI, FI, FI, FI, FI, ST, FI, FI, LB, FI, RB, ST, ST, /* 5_ */
+    FI, FI, FI, FI, FI, FI, FI, FI, FI, FI, FI, FI, FI, FI, FI, FI, /* 6_ */
+    FI, FI, FI, FI, FI, FI, FI, FI, FI, FI, FI, FI, FI, FI, FI, DE, /* 7_ */
+    HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, /* 8_ */
+    HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, /* 9_ */
+    HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, /* A_ */
+    HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, /* B_ */
+    HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, /* C_ */
+    HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, /* D_ */
+    HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, /* E_ */
+    HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, /* F_ */
+};
+
+/** States of the parser. */
+enum state {
+    GROUND,     /**< Out of any sequence.                */
+    ESCAPE,     /**< Received <ESC>.                     */
+    ESC_INTER,  /**< Intermediate bytes after <ESC>.     */
+    CSI_ENTRY,  /**< Received <ESC>[.                    */
+    CSI_PARAM,  /**< Parameters of a control sequence.   */
+    CSI_INTER,  /**< Intermediate bytes of a sequence.   */
+    CSI_IGNORE, /**< Malformed sequence until its final. */
+    SS3,        /**< Received <ESC>O.                    */
+    STRING,     /**< Payload of a control string.        */
+    STATES
+};
+
+/** Actions of the transitions. */
+enum action {
+    none,        /**< Nothing.                                  */
+    print,       /**< Pass a graphic character to the user.     */
+    execute,     /**< Pass a control character to the user.     */
+    clear,       /**< Start a new sequence.                     */
+    param,       /**< Add a digit or a separator to parameters. */
+    collect,     /**< Store an intermediate byte.               */
+    prefix,      /**< Store a private parameter byte.           */
+    escdispatch, /**< Pass an escape sequence to the user.      */
+    csidispatch, /**< Pass a control sequence to the user.      */
+    ss3dispatch, /**< Pass a SS3 sequence to the user.          */
+};
+
+/** Transition entry: Next state in the low nibble and action in the high one. */
+#define T( state, action ) ( (action) << 4 | (state) )
+
+/** Transitions for each state and class of byte. */
+static unsigned char const transitions[ STATES ][ CLASSES ] = {
+    [GROUND] = {
+        [CT] = T( GROUND, execute ),  [BL] = T( GROUND, execute ),
+        [CN] = T( GROUND, execute ),  [ES] = T( ESCAPE, clear ),
+        [IN] = T( GROUND, print ),    [DI] = T( GROUND, print ),
+        [SP] = T( GROUND, print ),    [PR] = T( GROUND, print ),
+        [LB] = T( GROUND, print ),    [RB] = T( GROUND, print ),
+        [SO] = T( GROUND, print ),    [ST] = T( GROUND, print ),
+        [FI] = T( GROUND, print ),    [DE] = T( GROUND, execute ),
+        [HI] = T( GROUND, print ),
+    },
+    [ESCAPE] = {
+        [CT] = T( ESCAPE, execute ),     [BL] = T( ESCAPE, execute ),
+        [CN] = T( GROUND, none ),        [ES] = T( ESCAPE, clear ),
+        [IN] = T( ESC_INTER, collect ),  [DI] = T( GROUND, escdispatch ),
+        [SP] = T( GROUND, escdispatch ), [PR] = T( GROUND, escdispatch ),
+        [LB] = T( CSI_ENTRY, none ),     [RB] = T( STRING, none ),
+        [SO] = T( SS3, none ),           [ST] = T( STRING, none ),
+        [FI] = T( GROUND, escdispatch ), [DE] = T( ESCAPE, none ),
+        [HI] = T( GROUND, none ),
+    },
+    [ESC_INTER] = {
+        [CT] = T( ESC_INTER, execute ),  [BL] = T( ESC_INTER, execute ),
+        [CN] = T( GROUND, none ),        [ES] = T( ESCAPE, clear ),
+        [IN] = T( ESC_INTER, collect ),  [DI] = T( GROUND, escdispatch ),
+        [SP] = T( GROUND, escdispatch ), [PR] = T( GROUND, escdispatch ),
+        [LB] = T( GROUND, escdispatch ), [RB] = T( GROUND, escdispatch ),
+        [SO] = T( GROUND, escdispatch ), [ST] = T( GROUND, escdispatch ),
+        [FI] = T( GROUND, escdispatch ), [DE] = T( ESC_INTER, none ),
+        [HI] = T( GROUND, none ),
+    },
+    [CSI_ENTRY] = {
+        [CT] = T( CSI_ENTRY, execute ),  [BL] = T( CSI_ENTRY, execute ),
+        [CN] = T( GROUND, none ),        [ES] = T( ESCAPE, clear ),
+        [IN] = T( CSI_INTER, collect ),  [DI] = T( CSI_PARAM, param ),
+        [SP] = T( CSI_PARAM, param ),    [PR] = T( CSI_PARAM, prefix ),
+        [LB] = T( GROUND, csidispatch ), [RB] = T( GROUND, csidispatch ),
+        [SO] = T( GROUND, csidispatch ), [ST] = T( GROUND, csidispatch ),
+        [FI] = T( GROUND, csidispatch ), [DE] = T( CSI_ENTRY, none ),
+        [HI] = T( GROUND, none ),
+    },
+    [CSI_PARAM] = {
+        [CT] = T( CSI_PARAM, execute ),  [BL] = T( CSI_PARAM, execute ),
+        [CN] = T( GROUND, none ),        [ES] = T( ESCAPE, clear ),
+        [IN] = T( CSI_INTER, collect ),  [DI] = T( CSI_PARAM, param ),
+        [SP] = T( CSI_PARAM, param ),    [PR] = T( CSI_IGNORE, none ),
+        [LB] = T( GROUND, csidispatch ), [RB] = T( GROUND, csidispatch ),
+        [SO] = T( GROUND, csidispatch ), [ST] = T( GROUND, csidispatch ),
+        [FI] = T( GROUND, csidispatch ), [DE] = T( CSI_PARAM, none ),
+        [HI] = T( GROUND, none ),
+    },
+    [CSI_INTER] = {
+        [CT] = T( CSI_INTER, execute ),  [BL] = T( CSI_INTER, execute ),
+        [CN] = T( GROUND, none ),        [ES] = T( ESCAPE, clear ),
+        [IN] = T( CSI_INTER, collect ),  [DI] = T( CSI_IGNORE, none ),
+        [SP] = T( CSI_IGNORE, none ),    [PR] = T( CSI_IGNORE, none ),
+        [LB] = T( GROUND, csidispatch ), [RB] = T( GROUND, csidispatch ),
+        [SO] = T( GROUND, csidispatch ), [ST] = T( GROUND, csidispatch ),
+        [FI] = T( GROUND, csidispatch ), [DE] = T( CSI_INTER, none ),
+        [HI] = T( GROUND, none ),
+    },
+    [CSI_IGNORE] = {
+        [CT] = T( CSI_IGNORE, execute ), [BL] = T( CSI_IGNORE, execute ),
+        [CN] = T( GROUND, none ),        [ES] = T( ESCAPE, clear ),
+        [IN] = T( CSI_IGNORE, none ),    [DI] = T( CSI_IGNORE, none ),
+        [SP] = T( CSI_IGNORE, none ),    [PR] = T( CSI_IGNORE, none ),
+        [LB] = T( GROUND, none ),        [RB] = T( GROUND, none ),
+        [SO] = T( GROUND, none ),        [ST] = T( GROUND, none ),
+        [FI] = T( GROUND, none ),        [DE] = T( CSI_IGNORE, none ),
+        [HI] = T( GROUND, none ),
+    },
+    [SS3] = {
+        [CT] = T( SS3, execute ),        [BL] = T( SS3, execute ),
+        [CN] = T( GROUND, none ),        [ES] = T( ESCAPE, clear ),
+        [IN] = T( GROUND, none ),        [DI] = T( SS3, param ),
+        [SP] = T( SS3, param ),          [PR] = T( GROUND, none ),
+        [LB] = T( GROUND, ss3dispatch ), [RB] = T( GROUND, ss3dispatch ),
+        [SO] = T( GROUND, ss3dispatch ), [ST] = T( GROUND, ss3dispatch ),
+        [FI] = T( GROUND, ss3dispatch ), [DE] = T( SS3, none ),
+        [HI] = T( GROUND, none ),
+    },
+    [STRING] = {
+        [CT] = T( STRING, none ),        [BL] = T( GROUND, none ),
+        [CN] = T( GROUND, none ),        [ES] = T( ESCAPE, clear ),
+        [IN] = T( STRING, none ),        [DI] = T( STRING, none ),
+        [SP] = T( STRING, none ),        [PR] = T( STRING, none ),
+        [LB] = T( STRING, none ),        [RB] = T( STRING, none ),
+        [SO] = T( STRING, none ),        [ST] = T( STRING, none ),
+        [FI] = T( STRING, none ),        [DE] = T( STRING, none ),
+        [HI] = T( STRING, none ),
+    },
+};
+
+/** Maximum value of a numeric parameter. */
+enum { maxparam = 0xFFFF };
+
+/* Initialize an ECMA-48 parser. */
+void ecma48_init( struct ecma48* p ) {
+    *p = ( struct ecma48 ) { .state = GROUND };
+}
+
+/** Add a digit or a separator to the parameters.
+  * Sequences with too many parameters are ignored.
+  * @param p Parser state.
+  * @param c Digit or separator. */
+static void addparam( struct ecma48* p, int c ) {
+    if( 0 == p->qty )
+        p->qty = 1;
+    if( ':' == c || ';' == c ) {
+        if( ECMA48_MAXPARAMS == p->qty )
+            p->state = CSI_IGNORE;
+        else
+            ++p->qty;
+        return;
+    }
+    int* const value = &p->param[ p->qty - 1 ];
+    *value = 10 * *value + c - '0';
+    if( maxparam < *value )
+        *value = maxparam;
+}
+
+/* Process a received byte. */
+int ecma48_parse( struct ecma48* p, int c ) {
+    unsigned char const entry = transitions[ p->state ][ classes[ c & 0xFF ] ];
+    p->state = entry & 0x0F;
+    switch( entry >> 4 ) {
+        case print:       return ECMA48_PRINT;
+        case execute:     return ECMA48_EXECUTE;
+        case escdispatch: return ECMA48_ESC;
+        case csidispatch: return ECMA48_CSI;
+        case ss3dispatch: return ECMA48_SS3;
+        case clear:
+            *p = ( struct ecma48 ) { .state = p->state };
+            break;
+        case param:
+            addparam( p, c );
+            break;
+        case collect:
+            p->inter = c;
+            break;
+        case prefix:
+            p->prefix = c;
+            break;
+    }
+    return ECMA48_NONE;
+}
+
+/* Check if the parser is in the ground state. */
+int ecma48_ground( struct ecma48 const* p ) {
+    return GROUND == p->state;
+}
+
+/* Get the number of bytes that are the payload of a control string. */
+int ecma48_skip( struct ecma48 const* p, char const* buf, int len ) {
+    if( STRING != p->state )
+        return 0;
+    int i = 0;
+    for(;;) {
+        /* The terminators are control characters, jump to the next one. */
+        i += ascii_cspan( buf + i, len - i, ASCII_CTRL );
+        if( len == i )
+            return i;
+        int const cls = classes[ (unsigned char)buf[i] ];
+        if( BL == cls || CN == cls || ES == cls )
+            return i;
+        ++i;
+    }
+}
+
@@ -0,0 +1,82 @@
+
+/*
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+  SPDX-License-Identifier: MIT
+  Copyright (c) 2018 Rafa Garcia <rafagarcia77@gmail.com>.
+  Permission is hereby  granted, free of charge, to any  person obtaining a copy
+  of this software and associated  documentation files (the "Software"), to deal
+  in the Software  without restriction, including without  limitation the rights
+  to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+  copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+  IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+  FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+  AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+  LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#ifndef ECMA48_H
+#define ECMA48_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/** Maximum number of numeric parameters of a control sequence. */
+#define ECMA48_MAXPARAMS 4
+
+/** State of an ECMA-48 parser. */
+struct ecma48 {
+    unsigned char state;  /**< State of the parser.                     */
+    unsigned char prefix; /**< Private parameter byte or zero.          */
+    unsigned char inter;  /**< Last intermediate byte or zero.          */
+    unsigned char qty;    /**< Number of parameters received.           */
+    /** Numeric parameters. The omitted ones are zero. */
+    int param[ ECMA48_MAXPARAMS ];
+};
+
+/** Actions to be done by the user of the parser after a byte. */
+enum ecma48_action {
+    ECMA48_NONE,    /**< Nothing to do.                                */
+    ECMA48_PRINT,   /**< The byte is a graphic character.              */
+    ECMA48_EXECUTE, /**< The byte is a control character.              */
+    ECMA48_ESC,     /**< The byte is the final of an escape sequence.  */
+    ECMA48_CSI,     /**< The byte is the final of a control sequence.  */
+    ECMA48_SS3,     /**< The byte is the one after <ESC>O.             */
+};
+
+/** Initialize an ECMA-48 parser.
+  * @param p Parser state. */
+void ecma48_init( struct ecma48* p );
+
+/** Process a received byte.
+  * @param p Parser state.
+  * @param c The received byte.
+  * @return The action to be done, see enum ecma48_action. The parameters and
+  *         intermediate bytes are valid until the next call. */
+int ecma48_parse( struct ecma48* p, int c );
+
+/** Check if the parser is in the ground state.
+  * @param p Parser state.
+  * @return Non-zero if it is not inside a sequence or string. */
+int ecma48_ground( struct ecma48 const* p );
+
+/** Get the number of bytes at the start of a buffer that are the payload of
+  * a control string (OSC, DCS, SOS, PM or APC) and can be discarded.
+  * @param p   Parser state.
+  * @param buf Received bytes.
+  * @param len Number of received bytes.
+  * @return The number of bytes that do not change the state of the parser. */
+int ecma48_skip( struct ecma48 const* p, char const* buf, int len );
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* ECMA48_H */
+
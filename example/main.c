@@ -29,46 +29,128 @@
 #include "../vt100.h"
 #include "../terminal-io.h"
 #include "../clarg.h"
+#include "../histshare.h"
+#ifndef _WIN32
+#include "../histlog.h"
+#endif
+#include "commands.h"
 
 static int command( void* p, char** argv, int argc );
 static int sum( void* p, char** argv, int argc );
 static int mult( void* p, char** argv, int argc );
 static int clear( void* p, char** argv, int argc );
 static int login( void* p, char** argv, int argc ); 
-static void printHistory( struct history const* hist, void* p );
+static void printHistory( struct history* hist, void* p );
+
+/* History shared by all the clients: */
+enum {
+    sharedlines = 64,
+    sharedlen   = 80
+};
+static struct histslot slots[ sharedlines ];
+static char sharedmem[ sharedlines ][ sharedlen ];
+static struct histsharecfg const sharecfg = {
+    .slots    = slots,
+    .lines    = *sharedmem,
+    .numslots = sharedlines,
+    .linelen  = sharedlen
+};
+static struct histshare share;
+
+/** History of a client: its log file and its session of the shared history. */
+struct clienthist {
+#ifndef _WIN32
+    struct histlog log;
+#endif
+    struct histsession session;
+};
+
+/** Store function of the history of a client. */
+static void store( void* p, char const* line, int len ) {
+    struct clienthist* const ch = (struct clienthist*)p;
+#ifndef _WIN32
+    histlog_store( &ch->log, line, len );
+    if( ch->log.loading )
+        return;
+#endif
+    histshare_store( &ch->session, line, len );
+}
 
 static void client( void* p ) {
 
-    /* Configure the hints: */
-    static char const* const names[] = {
-        "clear", "help", "exit", "command", "sum", "mult", "login", "history", "echo"
+    /* The hints are the commands of commands.txt, see commands.h. */
+
+    /* Configure the completion of the arguments: */
+    static char const* const onoff[] = { "on", "off" };
+    static struct hints const echoargs = { .str = onoff, .qty = 2 };
+    static struct hintnode const echonode = { .hints = &echoargs };
+    static char const* const usage[] = { "help" };
+    static struct hints const usageargs = { .str = usage, .qty = 1 };
+    static struct hintnode const usagenode = { .hints = &usageargs };
+    static struct hintnode const* const next[ commands_qty ] = {
+        [ commands_sum  ] = &usagenode,
+        [ commands_mult ] = &usagenode,
+        [ commands_echo ] = &echonode
     };
-    static struct hints const hints = {
-        .str  = names,
-        .qty  = sizeof names / sizeof *names
+    static struct hintnode const tree = {
+        .hints = &commands,
+        .next  = next
     };
 
-    /* Configure the history: */
+    /* Configure the history, persistent in a log file for each client and
+       shared with the other clients: */
     enum {
-        linelen  =  80,
-        numlines =  32
+        linelen  =   80,
+        numlines =  128,
+        size     = 4096
     };
+    struct historylinks links[ numlines ];
+    long heads[ HISTORY_LEVELS * numlines ];
+    int dups[ 2 * numlines ];
+    struct clienthist ch;
     struct historycfg const histcfg = {
-        .lines    = malloc( numlines * linelen ),
+        .lines    = malloc( size ),
         .linelen  = linelen,
-        .numlines = numlines
+        .numlines = numlines,
+        .size     = size,
+        .links    = links,
+        .heads    = heads,
+        .buckets  = numlines,
+        .dups     = dups,
+        .dupslots = 2 * numlines,
+        .store    = store,
+        .p        = &ch
     };
     struct history hist;
     history_init( &hist, &histcfg );
+    histshare_session( &ch.session, &share, &hist );
+#ifndef _WIN32
+    char path[ 32 ];
+    sprintf( path, "history%d.log", clientid( p ) );
+    char batch[ 4 * linelen ];
+    struct histlogcfg const logcfg = {
+        .path      = path,
+        .max       = 4 * size,
+        .batch     = batch,
+        .batchsize = sizeof batch,
+        .snap      = malloc( 2 * size ),
+        .snapsize  = 2 * size
+    };
+    if( 0 > histlog_open( &ch.log, &logcfg, &hist ) )
+        fprintf( stderr, "%s%s\n", "Cannot open history log: ", path );
+#endif
 
     /* Configure VT100: */
     char buff[ linelen ];
     struct vt100 const vt100 = {
-        .p     = p,
-        .max   = sizeof buff,
-        .line  = buff,
-        .hist  = &hist,
-        .hints = &hints,
+        .p      = p,
+        .max    = sizeof buff,
+        .line   = buff,
+        .hist   = &hist,
+        .hints  = &commands,
+        .tree   = &tree,
+        .rows   = 24,
+        .prompt = "\033[32m \\>\033[0m "
     };
 
     enum echo echo = echo_on;
@@ -76,10 +158,21 @@ static void client( void* p ) {
     /* Clear screen: */
     tputs( "\033c\033[2J", p );
 
+    /* Enable the bracketed paste: */
+    vt100_start( &vt100 );
+
     for(;;) {
 
+        /* Get the lines of the other clients: */
+        histshare_pull( &ch.session );
+
+#ifndef _WIN32
+        /* Hand the new lines to the writer of the log: */
+        histlog_flush( &ch.log );
+#endif
+
         /* Print prompt: */
-        tputs( "\033[32m \\>\033[0m ", p );
+        tputs( vt100.prompt, p );
 
         /* Get line: */
         int len = vt100_getline( &vt100, echo );
@@ -102,22 +195,27 @@ static void client( void* p ) {
         for( int i = 0; i < argc; ++i )
             printf( " [%d] %s\n", i, argv[i] );
 
+        /* Find the command in the perfect hash table: */
+        int const id = hints_find( &commands, *argv, strlen( *argv ) );
+        if( 0 > id )
+            continue;
+
         /* Process especial commands: */
-        if( 0 == strcmp( "exit", *argv ) )
+        if( commands_exit == id )
             break;
 
-        if ( 0 == strcmp( "help", *argv ) ) {
-            for( int i = 0; i < hints.qty; ++i )
-                tputs( hints.str[i], p ), tputs( "\r\n", p );
+        if ( commands_help == id ) {
+            for( int i = 0; i < commands.qty; ++i )
+                tputs( commands.str[i], p ), tputs( "\r\n", p );
             continue;
         }
 
-        if ( 0 == strcmp( "history", *argv ) ) {
+        if ( commands_history == id ) {
             printHistory( &hist, p );
             continue;
         }
 
-        if ( 0 == strcmp( "echo", *argv ) ) {
+        if ( commands_echo == id ) {
              if ( 2 != argc )
                  continue;
              if ( 0 == strcmp( "on", argv[1] ) )
@@ -128,29 +226,31 @@ static void client( void* p ) {
         }
 
         /* Process ordinary commands: */
-        static struct {
-            char const* name;
-            int(*func)(void*,char**,int);
-        } const cmd [] = {
-            { "sum",     sum     },
-            { "mult",    mult    },
-            { "command", command },
-            { "clear",   clear   },
-            { "login",   login   }
+        static int(* const cmd[ commands_qty ])(void*,char**,int) = {
+            [ commands_sum     ] = sum,
+            [ commands_mult    ] = mult,
+            [ commands_command ] = command,
+            [ commands_clear   ] = clear,
+            [ commands_login   ] = login
         };
-        for( int i = 0; i < sizeof cmd / sizeof *cmd; ++i ) {
-            if( 0 == strcmp( cmd[i].name, *argv ) ) {
-                int rslt = cmd[i].func( p, argv, argc );
-                printf( "%s%s%d\n", *argv, " return: ", rslt );
-                break;
-            }
+        if( NULL != cmd[ id ] ) {
+            int rslt = cmd[ id ]( p, argv, argc );
+            printf( "%s%s%d\n", *argv, " return: ", rslt );
         }
     }
 
+    /* Leave the terminal as it was: */
+    vt100_stop( &vt100 );
+
+#ifndef _WIN32
+    histlog_close( &ch.log );
+    free( logcfg.snap );
+#endif
     free( histcfg.lines );
 }
 
 int main( void ) {
+    histshare_init( &share, &sharecfg );
     return server( client );
 }
 
@@ -243,16 +343,10 @@ static int login( void* p, char** argv, int argc ) {
 }
 
 
-static void printHistory( struct history const* hist, void* p ) {
-    typedef char(*array_t)[hist->cfg->numlines][hist->cfg->linelen];
-    array_t const lines = (array_t)hist->cfg->lines;
-    if ( -1 == hist->newest )
-        return;
-    for( int i = hist->oldest;; i = hist->cfg->numlines - 1 == i ? 0 : i + 1 ) {
-        puts( (*lines)[i] );
-        tputs( (*lines)[i], p );
+static void printHistory( struct history* hist, void* p ) {
+    for( char const* line = history_oldest( hist ); NULL != line; line = history_newer( hist, line ) ) {
+        puts( line );
+        tputs( line, p );
         tputs( "\r\n", p );
-        if ( hist->newest == i )
-            return;        
     }
 }
@@ -57,6 +57,20 @@ int tputs( char const* str, void* p ) {
     return 0;
 }
 
+int tputn( char const* buf, int len, void* p ) {
+    struct client* client = (struct client*)p;
+    while( 0 < len ) {
+        ssize_t txlen = write( client->socket, buf, len );
+        if ( 0 >= txlen ) {
+            fprintf( stderr, "%s%zd\n", "send failed with error: ", txlen );
+            return -1;
+        }
+        buf += txlen;
+        len -= txlen;
+    }
+    return 0;
+}
+
 int tgetc( void* p ) {
     struct client* client = (struct client*)p;
     unsigned char data;
@@ -63,6 +63,20 @@ int tputs( char const* str, void* p ) {
     return 0;
 }
 
+int tputn( char const* buf, int len, void* p ) {
+    struct client* client = (struct client*)p;
+    while( 0 < len ) {
+        int txlen = send( client->socket, buf, len, 0 );
+        if ( SOCKET_ERROR == txlen ) {
+            fprintf( stderr, "%s%d\n", "send failed with error: ", WSAGetLastError() );
+            return -1;
+        }
+        buf += txlen;
+        len -= txlen;
+    }
+    return 0;
+}
+
 int tgetc( void* p ) {
     struct client* client = (struct client*)p;
     unsigned char data;
@@ -0,0 +1,404 @@
+
+/*
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+  SPDX-License-Identifier: MIT
+  Copyright (c) 2018 Rafa Garcia <rafagarcia77@gmail.com>.
+  Permission is hereby  granted, free of charge, to any  person obtaining a copy
+  of this software and associated  documentation files (the "Software"), to deal
+  in the Software  without restriction, including without  limitation the rights
+  to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+  copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+  IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+  FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+  AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+  LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include <string.h>
+#include "hints.h"
+#include "clarg.h"
+
+/** Compare two hints by their strings and then by their positions.
+  * @param hints The hints set.
+  * @param a     Position of a hint.
+  * @param b     Position of another hint.
+  * @return Negative, zero or positive like strcmp(). */
+static int compare( struct hints const* hints, int a, int b ) {
+    int const cmp = strcmp( hints->str[a], hints->str[b] );
+    return 0 != cmp ? cmp : a - b;
+}
+
+/** Move down an entry of a heap of positions until it is in its place.
+  * @param hints The hints set.
+  * @param heap  The heap.
+  * @param i     Entry to move.
+  * @param len   Number of entries of the heap. */
+static void siftdown( struct hints const* hints, int* heap, int i, int len ) {
+    for(;;) {
+        int child = 2 * i + 1;
+        if( child >= len )
+            return;
+        if( child + 1 < len && 0 > compare( hints, heap[child], heap[child+1] ) )
+            ++child;
+        if( 0 <= compare( hints, heap[i], heap[child] ) )
+            return;
+        int const tmp = heap[i];
+        heap[i]       = heap[child];
+        heap[child]   = tmp;
+        i = child;
+    }
+}
+
+/* Build the index of a set of hints. */
+void hints_index( struct hints const* hints, int* index ) {
+    int const qty = hints->qty;
+    for( int i = 0; i < qty; ++i )
+        index[i] = i;
+    for( int i = qty / 2 - 1; i >= 0; --i )
+        siftdown( hints, index, i, qty );
+    for( int len = qty - 1; len > 0; --len ) {
+        int const tmp = index[0];
+        index[0]      = index[len];
+        index[len]    = tmp;
+        siftdown( hints, index, 0, len );
+    }
+}
+
+/** Check if a hint starts with a prefix.
+  * The hint is not read beyond its null character.
+  * @param hint Null-terminated string with the hint.
+  * @param str  The prefix.
+  * @param len  Length of the prefix. */
+static int startswith( char const* hint, char const* str, int len ) {
+    return 0 == strncmp( hint, str, len );
+}
+
+/** Search the first position of the index whose hint is not less than a
+  * prefix, or greater than it if upper is set.
+  * @param hints The hints set with its index.
+  * @param str   The prefix.
+  * @param len   Length of the prefix.
+  * @param upper Non-zero to skip the hints that start with the prefix. */
+static int bound( struct hints const* hints, char const* str, int len, int upper ) {
+    int lo = 0;
+    int hi = hints->qty;
+    while( lo < hi ) {
+        int const mid = lo + ( hi - lo ) / 2;
+        int const cmp = strncmp( hints->str[ hints->index[mid] ], str, len );
+        if( 0 > cmp || ( upper && 0 == cmp ) )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/** Get the length of the common prefix of two strings.
+  * @param a Null-terminated string.
+  * @param b Null-terminated string. */
+static int commonlen( char const* a, char const* b ) {
+    int i = 0;
+    for( ; '\0' != a[i] && a[i] == b[i]; ++i );
+    return i;
+}
+
+/* Count the hints that start with a prefix. */
+int hints_count( struct hints const* hints, char const* str, int len, int* first ) {
+    if( NULL != hints->index ) {
+        int const lo = bound( hints, str, len, 0 );
+        if( NULL != first )
+            *first = lo;
+        return bound( hints, str, len, 1 ) - lo;
+    }
+    int count = 0;
+    for( int i = 0; i < hints->qty; ++i )
+        count += startswith( hints->str[i], str, len );
+    if( NULL != first )
+        *first = -1;
+    return count;
+}
+
+/* Get the longest common prefix of the hints that start with a prefix. */
+int hints_common( struct hints const* hints, char const* str, int len, char const** hint ) {
+    char const* match = NULL;
+    int common = -1;
+    if( NULL != hints->index ) {
+        int const lo = bound( hints, str, len, 0 );
+        int const hi = bound( hints, str, len, 1 );
+        if( lo < hi ) {
+            match  = hints->str[ hints->index[lo] ];
+            common = commonlen( match, hints->str[ hints->index[hi-1] ] );
+        }
+    }
+    else {
+        for( int i = 0; i < hints->qty; ++i ) {
+            if( !startswith( hints->str[i], str, len ) )
+                continue;
+            if( NULL == match ) {
+                match  = hints->str[i];
+                common = strlen( match );
+            }
+            else {
+                int const n = commonlen( match, hints->str[i] );
+                if( n < common )
+                    common = n;
+            }
+        }
+    }
+    if( NULL != hint )
+        *hint = match;
+    return common;
+}
+
+/* Get the hash of a string for a perfect hash table of hints. */
+unsigned long hints_hashof( char const* str, int len, unsigned long seed ) {
+    unsigned long hash = ( 2166136261ul ^ seed ) & 0xFFFFFFFFul;
+    for( int i = 0; i < len; ++i )
+        hash = ( ( hash ^ (unsigned char)str[i] ) * 16777619ul ) & 0xFFFFFFFFul;
+    return hash;
+}
+
+/* Search a hint that is equal to a string. */
+int hints_find( struct hints const* hints, char const* str, int len ) {
+    if( NULL != hints->hash ) {
+        struct hintshash const* const hash = hints->hash;
+        int const slot = hints_hashof( str, len, hash->seed ) & ( hash->size - 1 );
+        int const i = hash->slots[ slot ];
+        return 0 <= i && startswith( hints->str[i], str, len ) && '\0' == hints->str[i][len] ? i : -1;
+    }
+    if( NULL != hints->index ) {
+        int const lo = bound( hints, str, len, 0 );
+        if( lo == hints->qty )
+            return -1;
+        int const i = hints->index[lo];
+        return startswith( hints->str[i], str, len ) && '\0' == hints->str[i][len] ? i : -1;
+    }
+    for( int i = 0; i < hints->qty; ++i )
+        if( startswith( hints->str[i], str, len ) && '\0' == hints->str[i][len] )
+            return i;
+    return -1;
+}
+
+/* Get the hints of the word under the cursor from a completion tree. */
+struct hints const* hints_tree( struct hintnode const* tree, char const* line, int len, int* word ) {
+    int pos = 0;
+    for(;;) {
+        int arg;
+        int const n = clarg_find( line, len, &pos, &arg );
+        if( 0 > n ) {
+            *word = len;
+            return tree->hints;
+        }
+        if( arg + n == len ) {
+            *word = arg;
+            return tree->hints;
+        }
+        int const h = NULL != tree->hints ? hints_find( tree->hints, line + arg, n ) : -1;
+        tree = 0 <= h && NULL != tree->next ? tree->next[h] : tree->other;
+        if( NULL == tree )
+            return NULL;
+    }
+}
+
+/** Hints that start with a prefix. */
+struct matches {
+    int first;  /**< Lowest index of the matches.              */
+    int last;   /**< Highest index of the matches.             */
+    int after;  /**< Lowest index above a given one or -1.     */
+    int before; /**< Highest index below a given one or -1.    */
+};
+
+/** Search the hints that start with a prefix around a given one.
+  * With an index only the positions of the matches are visited.
+  * @param hints The hints set.
+  * @param str   The prefix.
+  * @param len   Length of the prefix.
+  * @param h     The given hint index.
+  * @return The matches. The first is -1 if there are not. */
+static struct matches search( struct hints const* hints, char const* str, int len, int h ) {
+    struct matches m = { .first = -1, .last = -1, .after = -1, .before = -1 };
+    int lo = 0;
+    int hi = hints->qty;
+    if( NULL != hints->index ) {
+        lo = bound( hints, str, len, 0 );
+        hi = bound( hints, str, len, 1 );
+    }
+    for( int k = lo; k < hi; ++k ) {
+        int const i = NULL != hints->index ? hints->index[k] : k;
+        if( NULL == hints->index && !startswith( hints->str[i], str, len ) )
+            continue;
+        if( 0 > m.first || i < m.first )
+            m.first = i;
+        if( m.last < i )
+            m.last = i;
+        if( i > h && ( 0 > m.after || i < m.after ) )
+            m.after = i;
+        if( i < h && m.before < i )
+            m.before = i;
+    }
+    return m;
+}
+
+/* Search in a hints set the next hint that starts with a prefix. */
+int hints_next( struct hints const* hints, char const* str, int len, int h ) {
+    if( 0 == len )
+        return hints->qty == h + 1 ? 0 : h + 1;
+    struct matches const m = search( hints, str, len, h );
+    if( 0 <= m.after )
+        return m.after;
+    return m.first < h ? m.first : -1;
+}
+
+/* Search in a hints set the previous hint that starts with a prefix. */
+int hints_prev( struct hints const* hints, char const* str, int len, int h ) {
+    if( 0 == len )
+        return 0 == h ? hints->qty - 1 : h - 1;
+    struct matches const m = search( hints, str, len, h );
+    if( 0 <= m.before )
+        return m.before;
+    return m.last > h ? m.last : -1;
+}
+
+
+/*
+ * Fuzzy search.
+ * The pattern is compiled in a mask for each byte value with a bit set for
+ * each position of the pattern where the byte is. Then each hint is read
+ * once keeping in a word which starts of the pattern are already found in
+ * order and in another which of them end just at the byte read, like the
+ * bitap algorithm does. So a hint is scored with a few bit operations for
+ * each of its bytes whatever the length of the pattern.
+ */
+
+/** Compiled pattern of a fuzzy search. */
+struct bitap {
+    unsigned long masks[ 256 ]; /**< Positions of each byte in the pattern. */
+    unsigned long last;         /**< Bit of the last position or zero.      */
+};
+
+/** Classes of fuzzy matches from the worst to the best. */
+enum { scattered = 1, contained, prefixed };
+
+/** Compile a pattern of a fuzzy search.
+  * @param b   Destination.
+  * @param str The pattern.
+  * @param len Length of the pattern.
+  * @return Zero if the pattern is too long or non-zero. */
+static int compile( struct bitap* b, char const* str, int len ) {
+    if( HINTS_FUZZYMAX < len )
+        return 0;
+    memset( b->masks, 0, sizeof b->masks );
+    for( int i = 0; i < len; ++i )
+        b->masks[ (unsigned char)str[i] ] |= 1ul << i;
+    b->last = 0 < len ? 1ul << ( len - 1 ) : 0;
+    return 1;
+}
+
+/** Score a hint with a compiled pattern.
+  * @param b    The compiled pattern.
+  * @param hint Null-terminated string with the hint.
+  * @param len  Length of the pattern.
+  * @return Zero if the hint does not match or a positive score. */
+static int score( struct bitap const* b, char const* hint, int len ) {
+    if( 0 == b->last )
+        return prefixed * ( HINTS_FUZZYMAX + 1 );
+    unsigned long found = 0; /* Starts of the pattern found in order.    */
+    unsigned long run   = 0; /* Starts of the pattern that end here.     */
+    unsigned long runs  = 0; /* Starts of the pattern found together.    */
+    for( int i = 0; '\0' != hint[i]; ++i ) {
+        unsigned long const mask = b->masks[ (unsigned char)hint[i] ];
+        found |= ( found << 1 | 1 ) & mask;
+        run    = ( run << 1 | 1 ) & mask;
+        runs  |= run;
+        if( run & b->last )
+            return ( i + 1 == len ? prefixed : contained ) * ( HINTS_FUZZYMAX + 1 ) + len;
+    }
+    if( 0 == ( found & b->last ) )
+        return 0;
+    int together = 0;
+    for( ; 0 != runs; runs >>= 1 )
+        ++together;
+    return scattered * ( HINTS_FUZZYMAX + 1 ) + together;
+}
+
+/* Score a hint as a fuzzy match of a pattern. */
+int hints_score( char const* hint, char const* str, int len ) {
+    struct bitap b;
+    return compile( &b, str, len ) ? score( &b, hint, len ) : 0;
+}
+
+/** Rank of a hint in a fuzzy search. */
+struct rank {
+    int score; /**< Score of the hint or zero if it does not match. */
+    int len;   /**< Length of the hint.                             */
+    int pos;   /**< Hint index.                                     */
+};
+
+/** Rank a hint with a compiled pattern.
+  * @param hints The hints set.
+  * @param b     The compiled pattern.
+  * @param len   Length of the pattern.
+  * @param pos   Hint index. */
+static struct rank rankof( struct hints const* hints, struct bitap const* b, int len, int pos ) {
+    struct rank r = { .score = score( b, hints->str[pos], len ), .len = 0, .pos = pos };
+    if( 0 != r.score )
+        r.len = strlen( hints->str[pos] );
+    return r;
+}
+
+/** Compare two ranks of a fuzzy search.
+  * @return Negative if a goes before b, positive if after. */
+static int rankcmp( struct rank const* a, struct rank const* b ) {
+    if( a->score != b->score )
+        return b->score - a->score;
+    if( a->len != b->len )
+        return a->len - b->len;
+    return a->pos - b->pos;
+}
+
+/** Search the hint that follows a given one in the order of a fuzzy search.
+  * @param hints The hints set.
+  * @param str   The pattern.
+  * @param len   Length of the pattern.
+  * @param h     The given hint index or -1.
+  * @param dir   1 to follow the order or -1 to reverse it.
+  * @return The index of the hint found or -1 if there are not matches. */
+static int fuzzy( struct hints const* hints, char const* str, int len, int h, int dir ) {
+    struct bitap b;
+    if( !compile( &b, str, len ) )
+        return -1;
+    struct rank given = { .score = 0 };
+    if( 0 <= h && h < hints->qty )
+        given = rankof( hints, &b, len, h );
+    struct rank near = { .score = 0 };
+    struct rank far  = { .score = 0 };
+    for( int i = 0; i < hints->qty; ++i ) {
+        struct rank const r = rankof( hints, &b, len, i );
+        if( 0 == r.score )
+            continue;
+        if( 0 != given.score && 0 < dir * rankcmp( &r, &given )
+            && ( 0 == near.score || 0 > dir * rankcmp( &r, &near ) ) )
+            near = r;
+        if( 0 == far.score || 0 > dir * rankcmp( &r, &far ) )
+            far = r;
+    }
+    if( 0 != near.score )
+        return near.pos;
+    return 0 != far.score ? far.pos : -1;
+}
+
+/* Search in a hints set the next hint that matches a fuzzy pattern. */
+int hints_fuzzynext( struct hints const* hints, char const* str, int len, int h ) {
+    return fuzzy( hints, str, len, h, 1 );
+}
+
+/* Search in a hints set the previous hint that matches a fuzzy pattern. */
+int hints_fuzzyprev( struct hints const* hints, char const* str, int len, int h ) {
+    return fuzzy( hints, str, len, h, -1 );
+}
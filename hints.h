@@ -0,0 +1,178 @@
+
+/*
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+  SPDX-License-Identifier: MIT
+  Copyright (c) 2018 Rafa Garcia <rafagarcia77@gmail.com>.
+  Permission is hereby  granted, free of charge, to any  person obtaining a copy
+  of this software and associated  documentation files (the "Software"), to deal
+  in the Software  without restriction, including without  limitation the rights
+  to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+  copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+  IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+  FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+  AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+  LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#ifndef HINTS_H
+#define HINTS_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/** Maximum length of a pattern of a fuzzy search, a bit for each character. */
+#define HINTS_FUZZYMAX 32
+
+/** Perfect hash table of a set of hints.
+  * It is generated with hintgen for sets of hints known at build time. */
+struct hintshash {
+    unsigned long seed; /**< Seed of hints_hashof() without collisions. */
+    int size;           /**< Number of slots. It is a power of two.    */
+    short const* slots; /**< Hint index of each slot or -1 if empty.   */
+};
+
+/** Set of hints for a line capture. */
+struct hints {
+    /** Pointer to array of null-terminated strings with the hints. */
+    char const* const* str;
+    /** Number of hints. */
+    int qty;
+    /** Positions of the hints sorted by their strings, built with
+      * hints_index(), or null to search the hints one by one. */
+    int const* index;
+    /** Perfect hash table of the hints or null to find them in the index. */
+    struct hintshash const* hash;
+};
+
+/** Node of a completion tree.
+  * The root has the hints of the first word of a command line, usually the
+  * commands. Each hint can lead to the node of the next word, for example
+  * the subcommands or the values of the first argument, and so on. */
+struct hintnode {
+    /** Hints of the word in this position or null if there are not. */
+    struct hints const* hints;
+    /** Nodes of the next word after each hint, in the same order as the
+      * hints, or null to use the field other. Its entries can be null. */
+    struct hintnode const* const* next;
+    /** Node of the next word after any other word or null. */
+    struct hintnode const* other;
+};
+
+/** Build the index of a set of hints.
+  * @param hints The hints set. Its index is not used.
+  * @param index Destination array of hints->qty positions. It has to be
+  *              set as the index of the hints set after it is built. */
+void hints_index( struct hints const* hints, int* index );
+
+/** Count the hints that start with a prefix.
+  * With an index it costs two binary searches and the matches are the
+  * consecutive positions of the index from the first one. Without an
+  * index all the hints are compared.
+  * @param hints The hints set.
+  * @param str   The prefix.
+  * @param len   Length of the prefix.
+  * @param first If not null, it is set with the first position of the index
+  *              with a match, or with -1 if the hints set has no index.
+  * @return The number of matches. */
+int hints_count( struct hints const* hints, char const* str, int len, int* first );
+
+/** Get the longest common prefix of the hints that start with a prefix.
+  * With an index only the first and the last matches are compared.
+  * @param hints The hints set.
+  * @param str   The prefix.
+  * @param len   Length of the prefix.
+  * @param hint  If not null, it is set with a hint that starts with the
+  *              common prefix or null if there are not matches.
+  * @return The length of the common prefix or -1 if there are not matches. */
+int hints_common( struct hints const* hints, char const* str, int len, char const** hint );
+
+/** Get the hash of a string for a perfect hash table of hints.
+  * It is the 32-bit FNV-1a hash with the seed mixed in its offset basis.
+  * @param str  The string.
+  * @param len  Length of the string.
+  * @param seed The seed.
+  * @return The hash. */
+unsigned long hints_hashof( char const* str, int len, unsigned long seed );
+
+/** Search a hint that is equal to a string.
+  * With a perfect hash table it costs a hash and a string comparison and
+  * with an index a binary search.
+  * @param hints The hints set.
+  * @param str   The string.
+  * @param len   Length of the string.
+  * @return The index of the hint found or -1 if there is not. */
+int hints_find( struct hints const* hints, char const* str, int len );
+
+/** Get the hints of the word under the cursor from a completion tree.
+  * The arguments before it are found with clarg_find(), so the quoting rules
+  * of clarg() apply, and each one moves from a node of the tree to the next.
+  * @param tree The root of the completion tree.
+  * @param line The command line. It does not need to be null-terminated.
+  * @param len  Position of the cursor in the line.
+  * @param word Destination of the position where the word under the cursor
+  *             starts, after the quotation mark if it is quoted.
+  * @return The hints for the word or null if there are not. */
+struct hints const* hints_tree( struct hintnode const* tree, char const* line, int len, int* word );
+
+/** Search in a hints set the next hint that starts with a prefix.
+  * The hints are cycled in the order of the array.
+  * @param hints The hints set.
+  * @param str   The prefix.
+  * @param len   Length of the prefix.
+  * @param h     Hint index where start to search.
+  * @return      The index of the hint found or -1 if there are not matches. */
+int hints_next( struct hints const* hints, char const* str, int len, int h );
+
+/** Search in a hints set the previous hint that starts with a prefix.
+  * The hints are cycled in the order of the array.
+  * @param hints The hints set.
+  * @param str   The prefix.
+  * @param len   Length of the prefix.
+  * @param h     Hint index where start to search.
+  * @return      The index of the hint found or -1 if there are not matches. */
+int hints_prev( struct hints const* hints, char const* str, int len, int h );
+
+/** Score a hint as a fuzzy match of a pattern.
+  * The characters of the pattern have to be in the hint in the same order.
+  * A hint that starts with the pattern scores more than one that contains it
+  * and that one more than one with the characters apart, which scores more
+  * the longer the start of the pattern found together is.
+  * @param hint Null-terminated string with the hint.
+  * @param str  The pattern.
+  * @param len  Length of the pattern. Up to HINTS_FUZZYMAX.
+  * @return Zero if the hint does not match or a positive score. */
+int hints_score( char const* hint, char const* str, int len );
+
+/** Search in a hints set the next hint that matches a fuzzy pattern.
+  * The matches are cycled from the highest score to the lowest. The ties
+  * go from the shortest hint to the longest and then in array order. All
+  * the hints are scored with a bit-parallel matcher on each call.
+  * @param hints The hints set.
+  * @param str   The pattern.
+  * @param len   Length of the pattern. Up to HINTS_FUZZYMAX.
+  * @param h     Actual hint index or -1 to get the best match.
+  * @return      The index of the hint found or -1 if there are not matches. */
+int hints_fuzzynext( struct hints const* hints, char const* str, int len, int h );
+
+/** Search in a hints set the previous hint that matches a fuzzy pattern.
+  * The matches are cycled in the reverse order of hints_fuzzynext().
+  * @param hints The hints set.
+  * @param str   The pattern.
+  * @param len   Length of the pattern. Up to HINTS_FUZZYMAX.
+  * @param h     Actual hint index or -1 to get the worst match.
+  * @return      The index of the hint found or -1 if there are not matches. */
+int hints_fuzzyprev( struct hints const* hints, char const* str, int len, int h );
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* HINTS_H */
+
@@ -0,0 +1,100 @@
+
+/*
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+  SPDX-License-Identifier: MIT
+  Copyright (c) 2018 Rafa Garcia <rafagarcia77@gmail.com>.
+  Permission is hereby  granted, free of charge, to any  person obtaining a copy
+  of this software and associated  documentation files (the "Software"), to deal
+  in the Software  without restriction, including without  limitation the rights
+  to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+  copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+  IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+  FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+  AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+  LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+/*
+ * The snapshots are counted references and they are never modified, so
+ * the line captures read them without locks. The only race is between a
+ * line capture that has read the pointer to the snapshot but not yet
+ * counted its reference and the replacement that releases the last one.
+ * The shared hints set counts the acquisitions in progress, and the
+ * replacement waits for them to end before releasing the old snapshot,
+ * like a grace period of RCU. The window is a few instructions long, so
+ * the replacement spins with a pause of the processor, but a line capture
+ * can be preempted inside it, so after a while it yields its processor
+ * until the line capture runs again. The counters and the pointer are
+ * read and written with the __atomic builtins, so it needs GCC or Clang.
+ */
+
+#include <stddef.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+#include "hintshare.h"
+
+enum {
+    spins = 1000 /**< Pauses before the replacement yields its processor. */
+};
+
+/** Wait a little in a spin loop.
+  * @param count Number of times it has been called in the loop. */
+static void relax( int count ) {
+    if( spins > count ) {
+#if defined( __i386__ ) || defined( __x86_64__ )
+        __builtin_ia32_pause();
+#elif defined( __aarch64__ ) || defined( __arm__ )
+        __asm__ __volatile__( "yield" );
+#endif
+        return;
+    }
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+/* Initialize a shared hints set. */
+void hintshare_init( struct hintshare* share, struct hintsnap* snap ) {
+    if( NULL != snap )
+        snap->refs = 1;
+    share->readers = 0;
+    __atomic_store_n( &share->snap, snap, __ATOMIC_SEQ_CST );
+}
+
+/* Get a reference to the actual snapshot of a shared hints set. */
+struct hintsnap* hintshare_acquire( struct hintshare* share ) {
+    __atomic_add_fetch( &share->readers, 1, __ATOMIC_SEQ_CST );
+    struct hintsnap* const snap = __atomic_load_n( &share->snap, __ATOMIC_SEQ_CST );
+    if( NULL != snap )
+        __atomic_add_fetch( &snap->refs, 1, __ATOMIC_SEQ_CST );
+    __atomic_sub_fetch( &share->readers, 1, __ATOMIC_SEQ_CST );
+    return snap;
+}
+
+/* Release a reference to a snapshot. */
+void hintshare_release( struct hintsnap* snap ) {
+    if( 0 == __atomic_sub_fetch( &snap->refs, 1, __ATOMIC_SEQ_CST ) && NULL != snap->free )
+        snap->free( snap );
+}
+
+/* Replace the snapshot of a shared hints set. */
+void hintshare_publish( struct hintshare* share, struct hintsnap* snap ) {
+    if( NULL != snap )
+        snap->refs = 1;
+    struct hintsnap* const old = __atomic_exchange_n( &share->snap, snap, __ATOMIC_SEQ_CST );
+    for( int count = 0; 0 != __atomic_load_n( &share->readers, __ATOMIC_SEQ_CST ); ++count )
+        relax( count );
+    if( NULL != old )
+        hintshare_release( old );
+}
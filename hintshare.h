@@ -0,0 +1,80 @@
+
+/*
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+  SPDX-License-Identifier: MIT
+  Copyright (c) 2018 Rafa Garcia <rafagarcia77@gmail.com>.
+  Permission is hereby  granted, free of charge, to any  person obtaining a copy
+  of this software and associated  documentation files (the "Software"), to deal
+  in the Software  without restriction, including without  limitation the rights
+  to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+  copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+  IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+  FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+  AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+  LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#ifndef HINTSHARE_H
+#define HINTSHARE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include "hints.h"
+
+/** Immutable snapshot of a hints set shared by many line captures. */
+struct hintsnap {
+    /** The hints set. Neither it nor its strings change once published. */
+    struct hints hints;
+    /** Function called when the last reference is released, to free the
+      * snapshot, or null if it is not freed. */
+    void (*free)( struct hintsnap* snap );
+    int refs; /**< Number of references. For internal use. */
+};
+
+/** Hints set shared by many line captures that can be replaced. */
+struct hintshare {
+    struct hintsnap* snap; /**< Actual snapshot. For internal use.          */
+    int readers;           /**< Acquisitions in progress. For internal use. */
+};
+
+/** Initialize a shared hints set.
+  * @param share The shared hints set.
+  * @param snap  The first snapshot or null. */
+void hintshare_init( struct hintshare* share, struct hintsnap* snap );
+
+/** Get a reference to the actual snapshot of a shared hints set.
+  * It does not lock, it costs a few atomic operations. The snapshot stays
+  * valid until the reference is released, even if it is replaced.
+  * @param share The shared hints set.
+  * @return The snapshot or null if there is not. */
+struct hintsnap* hintshare_acquire( struct hintshare* share );
+
+/** Release a reference to a snapshot.
+  * When the last one is released, the free function of the snapshot is called.
+  * @param snap The snapshot. */
+void hintshare_release( struct hintsnap* snap );
+
+/** Replace the snapshot of a shared hints set.
+  * The line captures that have the old snapshot keep using it until they
+  * release it. The reference of the shared hints set to the old snapshot
+  * is released once no line capture is in the middle of acquiring it.
+  * It spins until then, and yields its processor if that takes long, as
+  * when a line capture is preempted while it acquires the snapshot.
+  * Only one thread at a time can replace the snapshot.
+  * @param share The shared hints set.
+  * @param snap  The new snapshot or null. */
+void hintshare_publish( struct hintshare* share, struct hintsnap* snap );
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* HINTSHARE_H */
@@ -0,0 +1,369 @@
+
+/*
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+  SPDX-License-Identifier: MIT
+  Copyright (c) 2018 Rafa Garcia <rafagarcia77@gmail.com>.
+  Permission is hereby  granted, free of charge, to any  person obtaining a copy
+  of this software and associated  documentation files (the "Software"), to deal
+  in the Software  without restriction, including without  limitation the rights
+  to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+  copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+  IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+  FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+  AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+  LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+/*
+ * The log file starts with a magic string and then it has a record for
+ * each line stored in the history: the length of the line in two bytes,
+ * a checksum of the line in four bytes and the characters of the line.
+ * The file is only appended, so a crash can only tear the last record,
+ * which is detected by its length or its checksum and cut at the next
+ * load. The load maps the file and replays the records in the history
+ * without copying the file or scanning for line ends.
+ * The appends are copied to a half of the batch buffer, and when it is
+ * full it is handed to a writer thread that writes it with one call while
+ * the other half is filled, so the thread that edits the lines does not
+ * wait for the file. When the log is flushed and the file is over its
+ * maximum size, the entries of the history are copied to the snapshot
+ * buffer, as the history can only be read by its thread, and the writer
+ * writes them to a new file, waits for it and its directory to be on disk
+ * and renames it over the log, so the lines evicted from the history are
+ * lost. The records batched before the snapshot are in it, so they are
+ * discarded unless the writer is already writing them in the old file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "histlog.h"
+
+/** Magic string at the start of the log file. */
+static char const magic[] = "vt100hl1";
+
+enum {
+    magiclen = sizeof magic - 1, /**< Bytes of the magic string.         */
+    header   = 2 + 4             /**< Bytes of a record besides the line. */
+};
+
+/** Get the checksum of a line, the FNV-1a of its length and characters.
+  * @param line The line.
+  * @param len  The length of the line. */
+static unsigned long checkof( char const* line, int len ) {
+    unsigned long hash = 2166136261ul;
+    hash = ( ( hash ^ ( len & 0xFF ) ) * 16777619ul ) & 0xFFFFFFFFul;
+    hash = ( ( hash ^ ( len >> 8 ) ) * 16777619ul ) & 0xFFFFFFFFul;
+    for( int i = 0; i < len; ++i )
+        hash = ( ( hash ^ (unsigned char)line[i] ) * 16777619ul ) & 0xFFFFFFFFul;
+    return hash;
+}
+
+/** Write a buffer in a file.
+  * @param fd  File descriptor.
+  * @param buf The buffer.
+  * @param len The number of bytes.
+  * @return Zero on success or -1 on error. */
+static int writeall( int fd, char const* buf, int len ) {
+    while( 0 < len ) {
+        ssize_t const n = write( fd, buf, len );
+        if( 0 > n )
+            return -1;
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/** Write the record of a line in a buffer.
+  * @param buf  Destination buffer.
+  * @param line The line.
+  * @param len  The length of the line.
+  * @return The number of bytes of the record. */
+static int record( char* buf, char const* line, int len ) {
+    unsigned long const check = checkof( line, len );
+    unsigned char* const p = (unsigned char*)buf;
+    p[0] = len & 0xFF;
+    p[1] = len >> 8;
+    for( int i = 0; i < 4; ++i )
+        p[ 2 + i ] = ( check >> 8 * i ) & 0xFF;
+    memcpy( p + header, line, len );
+    return header + len;
+}
+
+/** Add to the history of a log the lines of the records of a log file.
+  * @param log  The log handle.
+  * @param map  The log file.
+  * @param size The size of the log file.
+  * @return The size of the valid records with the magic string. */
+static long replay( struct histlog* log, char const* map, long size ) {
+    char line[ log->hist->cfg->linelen ];
+    long at = magiclen;
+    log->loading = 1;
+    while( at + header <= size ) {
+        unsigned char const* const p = (unsigned char const*)map + at;
+        int const len = p[0] | p[1] << 8;
+        unsigned long check = 0;
+        for( int i = 0; i < 4; ++i )
+            check |= (unsigned long)p[ 2 + i ] << 8 * i;
+        if( at + header + len > size || check != checkof( map + at + header, len ) )
+            break;
+        int const cut = len < (int)sizeof line - 1 ? len : (int)sizeof line - 1;
+        memcpy( line, map + at + header, cut );
+        line[ cut ] = '\0';
+        history_line( log->hist, line );
+        at += header + len;
+    }
+    log->loading = 0;
+    return at;
+}
+
+/** Wait for the directory of a file to be on disk, so that the file
+  * renamed in it is found after a crash.
+  * @param path Path of the file.
+  * @return Zero on success or -1 on error. */
+static int syncdir( char const* path ) {
+    char const* const slash = strrchr( path, '/' );
+    int const len = NULL != slash ? slash - path + 1 : 0;
+    char dir[ len + 2 ];
+    memcpy( dir, path, len );
+    strcpy( dir + len, 0 == len ? "." : "" );
+    int const fd = open( dir, O_RDONLY );
+    if( 0 > fd )
+        return -1;
+    int const rslt = fsync( fd );
+    close( fd );
+    return rslt;
+}
+
+/** Replace the log file with the records of the snapshot buffer.
+  * It runs in the writer thread.
+  * @param log The log handle.
+  * @param len Bytes of the snapshot.
+  * @return The size of the new log file or -1 on error. */
+static long compact( struct histlog* log, long len ) {
+    char tmp[ strlen( log->cfg->path ) + sizeof ".tmp" ];
+    sprintf( tmp, "%s.tmp", log->cfg->path );
+    int const fd = open( tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    if( 0 > fd )
+        return -1;
+    int err = writeall( fd, magic, magiclen ) || writeall( fd, log->cfg->snap, len ) || fsync( fd );
+    if( 0 > close( fd ) || err || 0 > rename( tmp, log->cfg->path ) ) {
+        unlink( tmp );
+        return -1;
+    }
+    err = syncdir( log->cfg->path );
+    close( log->fd );
+    log->fd = open( log->cfg->path, O_RDWR | O_APPEND );
+    return 0 > log->fd || err ? -1 : magiclen + len;
+}
+
+/** Write the log file with the work handed by the thread of the history.
+  * The compaction goes before the full half, that was handed after it.
+  * @param p The log handle.
+  * @return Null. */
+static void* writer( void* p ) {
+    struct histlog* const log = p;
+    pthread_mutex_lock( &log->lock );
+    for(;;) {
+        if( 0 <= log->snaplen ) {
+            long const len = log->snaplen;
+            log->snaplen = -1;
+            pthread_mutex_unlock( &log->lock );
+            long const size = compact( log, len );
+            pthread_mutex_lock( &log->lock );
+            if( 0 > size )
+                log->err = 1;
+            else
+                log->size = size;
+            log->compacting = 0;
+        }
+        else if( 0 < log->fulllen ) {
+            int const len = log->fulllen;
+            log->writing = 1;
+            pthread_mutex_unlock( &log->lock );
+            int const err = writeall( log->fd, log->full, len );
+            pthread_mutex_lock( &log->lock );
+            if( err )
+                log->err = 1;
+            log->size += len;
+            log->fulllen = 0;
+            log->writing = 0;
+            pthread_cond_broadcast( &log->done );
+        }
+        else if( log->stop )
+            break;
+        else
+            pthread_cond_wait( &log->wake, &log->lock );
+    }
+    pthread_mutex_unlock( &log->lock );
+    return NULL;
+}
+
+/** Hand the filled half of the batch buffer to the writer thread.
+  * @param log  The log handle.
+  * @param wait Non-zero to wait for the writer to end with the other half.
+  *             Otherwise the appends stay in the filled half if it has not. */
+static void handoff( struct histlog* log, int wait ) {
+    if( 0 == log->pending )
+        return;
+    pthread_mutex_lock( &log->lock );
+    while( wait && 0 != log->fulllen )
+        pthread_cond_wait( &log->done, &log->lock );
+    if( 0 == log->fulllen ) {
+        int const half = log->cfg->batchsize / 2;
+        log->full    = log->fill;
+        log->fulllen = log->pending;
+        log->fill    = log->cfg->batch + ( log->fill == log->cfg->batch ? half : 0 );
+        log->pending = 0;
+        pthread_cond_signal( &log->wake );
+    }
+    pthread_mutex_unlock( &log->lock );
+}
+
+/** Copy the records of the newest entries of the history that fit in the
+  * snapshot buffer.
+  * @param log The log handle.
+  * @return Bytes of the snapshot. */
+static long snapshot( struct histlog* log ) {
+    struct history* const hist = log->hist;
+    long total = 0;
+    for( char const* e = history_oldest( hist ); NULL != e; e = history_newer( hist, e ) )
+        total += header + strlen( e );
+    char const* e = history_oldest( hist );
+    for( ; NULL != e && total > log->cfg->snapsize; e = history_newer( hist, e ) )
+        total -= header + strlen( e );
+    long len = 0;
+    for( ; NULL != e; e = history_newer( hist, e ) )
+        len += record( log->cfg->snap + len, e, strlen( e ) );
+    return len;
+}
+
+/* Open the log file of a history and load its entries in the history. */
+int histlog_open( struct histlog* log, struct histlogcfg const* cfg, struct history* hist ) {
+    log->cfg        = cfg;
+    log->hist       = hist;
+    log->size       = 0;
+    log->fill       = cfg->batch;
+    log->pending    = 0;
+    log->full       = NULL;
+    log->fulllen    = 0;
+    log->writing    = 0;
+    log->snaplen    = -1;
+    log->compacting = 0;
+    log->stop       = 0;
+    log->err        = 0;
+    log->running    = 0;
+    log->loading    = 0;
+    log->fd = open( cfg->path, O_RDWR | O_CREAT | O_APPEND, 0644 );
+    if( 0 > log->fd )
+        return -1;
+    struct stat st;
+    if( 0 > fstat( log->fd, &st ) )
+        goto error;
+    if( 0 == st.st_size ) {
+        if( 0 > writeall( log->fd, magic, magiclen ) )
+            goto error;
+        log->size = magiclen;
+    }
+    else {
+        if( magiclen > st.st_size )
+            goto error;
+        char const* const map = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, log->fd, 0 );
+        if( MAP_FAILED == map )
+            goto error;
+        long valid = -1;
+        if( 0 == memcmp( map, magic, magiclen ) )
+            valid = replay( log, map, st.st_size );
+        munmap( (void*)map, st.st_size );
+        if( 0 > valid || ( valid != st.st_size && 0 > ftruncate( log->fd, valid ) ) )
+            goto error;
+        log->size = valid;
+    }
+    pthread_mutex_init( &log->lock, NULL );
+    pthread_cond_init( &log->wake, NULL );
+    pthread_cond_init( &log->done, NULL );
+    if( 0 != pthread_create( &log->writer, NULL, writer, log ) ) {
+        pthread_cond_destroy( &log->done );
+        pthread_cond_destroy( &log->wake );
+        pthread_mutex_destroy( &log->lock );
+        goto error;
+    }
+    log->running = 1;
+    return 0;
+error:
+    close( log->fd );
+    log->fd = -1;
+    return -1;
+}
+
+/* Append a line stored in a history to its log. */
+void histlog_store( void* p, char const* line, int len ) {
+    struct histlog* const log = p;
+    if( log->loading || !log->running )
+        return;
+    int const half = log->cfg->batchsize / 2;
+    if( header + len > half )
+        len = half - header;
+    if( log->pending + header + len > half )
+        handoff( log, 1 );
+    log->pending += record( log->fill + log->pending, line, len );
+}
+
+/* Hand the batched appends to the writer thread and compact if too big. */
+int histlog_flush( struct histlog* log ) {
+    if( !log->running )
+        return -1;
+    handoff( log, 0 );
+    pthread_mutex_lock( &log->lock );
+    int const due = !log->compacting && 0 < log->cfg->max && log->size > log->cfg->max;
+    if( due )
+        log->compacting = 1;
+    pthread_mutex_unlock( &log->lock );
+    if( due ) {
+        long const len = snapshot( log );
+        pthread_mutex_lock( &log->lock );
+        log->snaplen = len;
+        log->pending = 0;
+        if( !log->writing )
+            log->fulllen = 0;
+        pthread_cond_signal( &log->wake );
+        pthread_mutex_unlock( &log->lock );
+    }
+    pthread_mutex_lock( &log->lock );
+    int const err = log->err;
+    pthread_mutex_unlock( &log->lock );
+    return err ? -1 : 0;
+}
+
+/* Write the batched appends to the log file and close it. */
+int histlog_close( struct histlog* log ) {
+    if( !log->running )
+        return -1;
+    handoff( log, 1 );
+    pthread_mutex_lock( &log->lock );
+    log->stop = 1;
+    pthread_cond_signal( &log->wake );
+    pthread_mutex_unlock( &log->lock );
+    pthread_join( log->writer, NULL );
+    pthread_cond_destroy( &log->done );
+    pthread_cond_destroy( &log->wake );
+    pthread_mutex_destroy( &log->lock );
+    log->running = 0;
+    int const err = log->err || 0 > log->fd || fsync( log->fd );
+    int const rslt = 0 > log->fd ? 0 : close( log->fd );
+    log->fd = -1;
+    return err || 0 > rslt ? -1 : 0;
+}
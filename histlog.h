@@ -0,0 +1,118 @@
+
+/*
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+  SPDX-License-Identifier: MIT
+  Copyright (c) 2018 Rafa Garcia <rafagarcia77@gmail.com>.
+  Permission is hereby  granted, free of charge, to any  person obtaining a copy
+  of this software and associated  documentation files (the "Software"), to deal
+  in the Software  without restriction, including without  limitation the rights
+  to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+  copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+  IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+  FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+  AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+  LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#ifndef HISTLOG_H
+#define HISTLOG_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include "history.h"
+
+/** Persistent history log configuration. */
+struct histlogcfg {
+    char const* path; /**< Path of the log file.                          */
+    /** Size of the log file in bytes over which it is compacted when it is
+      * flushed, or zero for never. It should be a few times the history
+      * memory block. */
+    long max;
+    /** Buffer to batch the appends. It is split in two halves: the lines
+      * stored fill one while the writer thread writes the other. Each half
+      * has at least linelen plus six bytes. */
+    char* batch;
+    int batchsize;    /**< Size of the batch buffer in bytes.             */
+    /** Buffer for the records of the entries of the history when the log
+      * is compacted, or null if max is zero. The newest entries that fit
+      * are kept, so it should be the history memory block plus six bytes
+      * for each entry. */
+    char* snap;
+    long snapsize;    /**< Size of the snapshot buffer in bytes.          */
+};
+
+/** It handles the log file of a history. */
+struct histlog {
+    struct histlogcfg const* cfg;
+    struct history* hist; /**< The history.                               */
+    int fd;               /**< File descriptor of the log file.           */
+    long size;            /**< Bytes written in the log file.             */
+    char* fill;           /**< Half of the batch buffer that is filled.   */
+    int pending;          /**< Bytes in the half that is filled.          */
+    char const* full;     /**< Half of the batch buffer to be written.    */
+    int fulllen;          /**< Bytes to be written or zero.               */
+    int writing;          /**< The writer is writing the full half.       */
+    long snaplen;         /**< Bytes of the snapshot to compact or -1.    */
+    int compacting;       /**< A compaction is requested or in progress.  */
+    int stop;             /**< The writer has to end.                     */
+    int err;              /**< The writer failed.                         */
+    int running;          /**< The writer thread is running.              */
+    int loading;          /**< The log file is being loaded.              */
+    pthread_t writer;     /**< Thread that writes the log file.           */
+    pthread_mutex_t lock; /**< It guards the fields shared with it.       */
+    pthread_cond_t wake;  /**< There is work for the writer.              */
+    pthread_cond_t done;  /**< The writer wrote the full half.            */
+};
+
+/** Open the log file of a history and load its entries in the history.
+  * The history configuration has to have histlog_store as store function
+  * and the log handle as its parameter, so that each line added to the
+  * history is appended to the log. A torn record at the end of the log,
+  * from a crash in the middle of a write, is discarded. Then it starts the
+  * writer thread of the log.
+  * @param log  The log handle.
+  * @param cfg  Log configuration.
+  * @param hist A valid history handle.
+  * @return Zero on success or -1 if the file cannot be used as a log. */
+int histlog_open( struct histlog* log, struct histlogcfg const* cfg, struct history* hist );
+
+/** Append a line stored in a history to its log.
+  * It is the store function of the history configuration. It copies the
+  * line to the batch buffer and, when a half is full, hands it to the
+  * writer thread. It does not write in the file. It only waits if the
+  * writer has not yet written the other half.
+  * @param p    The log handle.
+  * @param line The line.
+  * @param len  The length of the line. */
+void histlog_store( void* p, char const* line, int len );
+
+/** Hand the batched appends to the writer thread.
+  * If the log file is over its maximum size, the entries of the history
+  * are copied to the snapshot buffer and the writer replaces the log file
+  * with them. It never waits for the writer: the appends stay batched if
+  * it is busy. Call it from the thread that edits the lines, when no line
+  * is edited, for example before printing the prompt.
+  * @param log The log handle.
+  * @return Zero on success or -1 if a write of the writer has failed. */
+int histlog_flush( struct histlog* log );
+
+/** Write the batched appends to the log file, wait for the writer thread
+  * to end and close the file.
+  * @param log The log handle.
+  * @return Zero on success or -1 on error. */
+int histlog_close( struct histlog* log );
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* HISTLOG_H */
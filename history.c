@@ -21,74 +21,722 @@
 */
 
 #include <string.h>
+#include <limits.h>
 #include "history.h"
 
+/*
+ * Arena.
+ * The entries are stored back to back in a ring of bytes, from the oldest
+ * to the newest, so each one takes only the room of its string. Each entry
+ * has the length of its string before and after it, so the ring is walked
+ * both ways in constant time per entry, and the null character after it,
+ * so it is returned in place. An entry never wraps: if it does not fit at
+ * the end of the memory block it is stored at its start, and where the
+ * entries before it end is kept. The oldest entries are evicted to make
+ * room for the new ones.
+ */
+
+/** Bytes of an entry besides the characters of its string. */
+enum { overhead = 2 + 1 + 2 };
+
+/** Flag in the leading length of an entry that was dropped. */
+enum { dropped = 0x8000 };
+
+/*
+ * Front coding.
+ * With restart points, an entry stores only the characters that are not
+ * at the start of the entry before it, after the number of characters in
+ * common. After restart entries stored this way, one is stored in full,
+ * and also the entries with nothing in common with the one before. The
+ * string of an entry is decoded from the last entry stored in full, so it
+ * costs up to restart copies, and the walks from the oldest to the newest
+ * decode each entry from the one before. The oldest entry and the entry at
+ * the start of the memory block are always stored in full, so the entries
+ * are never coded against evicted ones or across the wrap of the ring:
+ * when the oldest entry is evicted, the next live one is stored again in
+ * full, ending where it ended, over the room of the evicted ones. The first
+ * two lines of linelen bytes of the memory block are the buffers where the
+ * entries are decoded: one for the entries returned and one for the
+ * internal comparisons.
+ */
+
+/** Check if a history configuration has front coding.
+  * @param cfg History configuration. */
+static int coded( struct historycfg const* cfg ) {
+    return 0 < cfg->restart;
+}
+
+/** Get the bytes at the start of the memory block of a history that are
+  * not used for the entries.
+  * @param cfg History configuration. */
+static int reserved( struct historycfg const* cfg ) {
+    return coded( cfg ) ? 2 * cfg->linelen : 0;
+}
+
+/** Get the size of the memory block of a history for its entries.
+  * @param cfg History configuration. */
+static int arenasize( struct historycfg const* cfg ) {
+    int const size = 0 != cfg->size ? cfg->size : cfg->numlines * cfg->linelen;
+    return size - reserved( cfg );
+}
+
+/** Get the memory of a history for its entries.
+  * @param hist A valid history handle. */
+static unsigned char* arena( struct history const* hist ) {
+    return (unsigned char*)hist->cfg->lines + reserved( hist->cfg );
+}
+
+/** Get the buffer of a history for the decoded entries that are returned.
+  * @param hist A valid history handle with front coding. */
+static char* result( struct history const* hist ) {
+    return (char*)hist->cfg->lines;
+}
+
+/** Get the buffer of a history for the decoded entries that are compared.
+  * @param hist A valid history handle with front coding. */
+static char* scratch( struct history const* hist ) {
+    return (char*)hist->cfg->lines + hist->cfg->linelen;
+}
+
+/** Get the bytes of the entries of a history before their characters.
+  * @param hist A valid history handle. */
+static int headsize( struct history const* hist ) {
+    return coded( hist->cfg ) ? 4 : 2;
+}
+
+/** Get a length stored in two bytes of the memory of the entries.
+  * @param hist A valid history handle.
+  * @param at   Offset of the length. */
+static int getlen( struct history const* hist, int at ) {
+    unsigned char const* const p = arena( hist ) + at;
+    return ( p[0] | p[1] << 8 ) & ~dropped;
+}
+
+/** Check if an entry of a history was dropped as a duplicate.
+  * @param hist A valid history handle.
+  * @param at   Offset of the entry. */
+static int dead( struct history const* hist, int at ) {
+    unsigned char const* const p = arena( hist ) + at;
+    return 0 != ( ( p[0] | p[1] << 8 ) & dropped );
+}
+
+/** Store a length in two bytes of the memory of the entries.
+  * @param hist A valid history handle.
+  * @param at   Offset of the length.
+  * @param len  The length. */
+static void setlen( struct history* hist, int at, int len ) {
+    unsigned char* const p = arena( hist ) + at;
+    p[0] = len & 0xFF;
+    p[1] = len >> 8;
+}
+
+/** Get the number of characters of an entry in common with the one before.
+  * @param hist A valid history handle.
+  * @param at   Offset of the entry. */
+static int prefix( struct history const* hist, int at ) {
+    return coded( hist->cfg ) ? getlen( hist, at + 2 ) : 0;
+}
+
+/** Get the characters stored in an entry of a history.
+  * @param hist A valid history handle.
+  * @param at   Offset of the entry. */
+static char const* stored( struct history const* hist, int at ) {
+    return (char const*)arena( hist ) + at + headsize( hist );
+}
+
+/** Get the length of the string of an entry of a history.
+  * @param hist A valid history handle.
+  * @param at   Offset of the entry. */
+static int strlenof( struct history const* hist, int at ) {
+    return prefix( hist, at ) + getlen( hist, at );
+}
+
+/** Get the bytes of an entry of a history.
+  * @param hist A valid history handle.
+  * @param at   Offset of the entry. */
+static int sizeofentry( struct history const* hist, int at ) {
+    return headsize( hist ) + getlen( hist, at ) + 1 + 2;
+}
+
+/** Get the offset of the entry after another one.
+  * @param hist A valid history handle.
+  * @param at   Offset of an entry that is not the newest. */
+static int next( struct history const* hist, int at ) {
+    int const after = at + sizeofentry( hist, at );
+    return after == hist->end ? 0 : after;
+}
+
+/** Get the offset of the entry before another one.
+  * @param hist A valid history handle.
+  * @param at   Offset of an entry that is not the oldest. */
+static int prev( struct history const* hist, int at ) {
+    int const before = 0 == at ? hist->end : at;
+    return before - getlen( hist, before - 2 ) - 1 - 2 - headsize( hist );
+}
+
+/** Store an entry in the memory of a history.
+  * @param hist   A valid history handle.
+  * @param at     Offset of the entry.
+  * @param str    The string of the entry.
+  * @param len    The length of the string.
+  * @param common Characters in common with the entry before it. */
+static void put( struct history* hist, int at, char const* str, int len, int common ) {
+    int const head = headsize( hist );
+    unsigned char* const dest = arena( hist ) + at;
+    setlen( hist, at, len - common );
+    if( coded( hist->cfg ) )
+        setlen( hist, at + 2, common );
+    memmove( dest + head, str + common, len - common );
+    dest[ head + len - common ] = '\0';
+    setlen( hist, at + head + len - common + 1, len - common );
+}
+
+/** Add to a decoded string the characters stored in the next entry.
+  * @param hist A valid history handle.
+  * @param at   Offset of the next entry.
+  * @param buf  The decoded string of the entry before it. */
+static void extend( struct history const* hist, int at, char* buf ) {
+    memcpy( buf + prefix( hist, at ), stored( hist, at ), getlen( hist, at ) + 1 );
+}
+
+/** Get the string of an entry of a history.
+  * @param hist A valid history handle.
+  * @param at   Offset of the entry.
+  * @param buf  Buffer of linelen bytes to decode it with front coding.
+  * @return The string. */
+static char const* string( struct history const* hist, int at, char* buf ) {
+    if( !coded( hist->cfg ) )
+        return stored( hist, at );
+    int from = at;
+    while( 0 != prefix( hist, from ) )
+        from = prev( hist, from );
+    extend( hist, from, buf );
+    while( from != at ) {
+        from = next( hist, from );
+        extend( hist, from, buf );
+    }
+    return buf;
+}
+
+/*
+ * Duplicates.
+ * With the duplicates table, a line that is in the history is not stored
+ * again: the old entry is dropped and the line is added as the newest.
+ * The table is a hash with open addressing and linear probing with the
+ * offsets of the live entries. A dropped entry is flagged and skipped in
+ * the walks and the searches, so dropping does not move any entry. When
+ * the dropped entries take a quarter of the memory block or of numlines,
+ * they are compacted out before any live entry is evicted. A compaction
+ * costs as much as the entries and the tables, but it frees a quarter of
+ * the history at least, so adding a line is still O(1) on average. The
+ * oldest and the newest entries are never dropped ones.
+ */
+
+/** Get the hash of a string.
+  * @param str The string.
+  * @param len The length of the string. */
+static unsigned long hashof( char const* str, int len ) {
+    unsigned long hash = 2166136261ul;
+    for( int i = 0; i < len; ++i )
+        hash = ( ( hash ^ (unsigned char)str[i] ) * 16777619ul ) & 0xFFFFFFFFul;
+    return hash;
+}
+
+/** Get the home slot in the duplicates table of the entry at an offset.
+  * @param hist A valid history handle with duplicates table.
+  * @param at   Offset of the entry. */
+static int home( struct history const* hist, int at ) {
+    char const* const str = string( hist, at, scratch( hist ) );
+    return hashof( str, strlenof( hist, at ) ) & ( hist->cfg->dupslots - 1 );
+}
+
+/** Search a string in the duplicates table.
+  * @param hist A valid history handle with duplicates table.
+  * @param str  The string.
+  * @param len  The length of the string.
+  * @return The slot of the entry equal to the string or -1 if not found. */
+static int dupfind( struct history const* hist, char const* str, int len ) {
+    int const mask = hist->cfg->dupslots - 1;
+    int slot = hashof( str, len ) & mask;
+    for( int i = 0; i <= mask; ++i, slot = ( slot + 1 ) & mask ) {
+        int const at = hist->cfg->dups[ slot ];
+        if( 0 > at )
+            return -1;
+        if( len == strlenof( hist, at ) && 0 == memcmp( str, string( hist, at, scratch( hist ) ), len ) )
+            return slot;
+    }
+    return -1;
+}
+
+/** Add the entry at an offset to the duplicates table.
+  * If the table is full the entry is not added.
+  * @param hist A valid history handle with duplicates table.
+  * @param at   Offset of the entry.
+  * @param str  The string of the entry.
+  * @param len  The length of the string. */
+static void dupadd( struct history* hist, int at, char const* str, int len ) {
+    int const mask = hist->cfg->dupslots - 1;
+    int slot = hashof( str, len ) & mask;
+    for( int i = 0; i <= mask; ++i, slot = ( slot + 1 ) & mask ) {
+        if( 0 > hist->cfg->dups[ slot ] ) {
+            hist->cfg->dups[ slot ] = at;
+            return;
+        }
+    }
+}
+
+/** Remove the entry at an offset from the duplicates table.
+  * The following entries of its cluster are shifted back.
+  * @param hist A valid history handle with duplicates table.
+  * @param at   Offset of the entry.
+  * @param str  The string of the entry. */
+static void dupdel( struct history* hist, int at, char const* str ) {
+    int* const dups = hist->cfg->dups;
+    int const mask = hist->cfg->dupslots - 1;
+    int hole = hashof( str, strlenof( hist, at ) ) & mask;
+    for( int i = 0; dups[ hole ] != at; ++i, hole = ( hole + 1 ) & mask )
+        if( 0 > dups[ hole ] || i == mask )
+            return;
+    for( int slot = ( hole + 1 ) & mask; 0 <= dups[ slot ]; slot = ( slot + 1 ) & mask ) {
+        int const h = home( hist, dups[ slot ] );
+        int const stays = hole < slot ? hole < h && h <= slot : hole < h || h <= slot;
+        if( !stays ) {
+            dups[ hole ] = dups[ slot ];
+            hole = slot;
+        }
+    }
+    dups[ hole ] = -1;
+}
+
+/** Remove the oldest entry of a history from its memory.
+  * @param hist A valid history handle that is not empty. */
+static void advance( struct history* hist ) {
+    if( 0 == --hist->count ) {
+        hist->oldest = 0;
+        hist->newest = -1;
+        hist->end    = arenasize( hist->cfg );
+        return;
+    }
+    int const after = hist->oldest + sizeofentry( hist, hist->oldest );
+    if( after != hist->end )
+        hist->oldest = after;
+    else {
+        hist->oldest = 0;
+        hist->end    = arenasize( hist->cfg );
+    }
+}
+
+/** Store in full the oldest entry of a history when it is coded against
+  * evicted ones. It is moved back to end where it ended.
+  * @param hist A valid history handle that is not empty. */
+static void restore( struct history* hist ) {
+    int const at = hist->oldest;
+    int const common = prefix( hist, at );
+    if( 0 == common )
+        return;
+    int const len = strlenof( hist, at );
+    char const* const str = string( hist, at, result( hist ) );
+    int const to = at - common;
+    if( NULL != hist->cfg->dups )
+        dupdel( hist, at, str );
+    put( hist, to, str, len, 0 );
+    if( NULL != hist->cfg->dups )
+        dupadd( hist, to, str, len );
+    if( NULL != hist->cfg->links )
+        hist->cfg->links[ ( hist->seq - hist->count + 1 ) % hist->cfg->numlines ].at = to;
+    if( at == hist->newest ) {
+        hist->newest = to;
+        hist->run    = 0;
+    }
+    hist->oldest = to;
+}
+
+/** Remove the oldest entry of a history and the dropped ones after it.
+  * @param hist A valid history handle that is not empty. */
+static void evict( struct history* hist ) {
+    do {
+        if( dead( hist, hist->oldest ) ) {
+            --hist->dead;
+            hist->waste -= sizeofentry( hist, hist->oldest );
+        }
+        else if( NULL != hist->cfg->dups )
+            dupdel( hist, hist->oldest, string( hist, hist->oldest, result( hist ) ) );
+        advance( hist );
+    } while( 0 != hist->count && dead( hist, hist->oldest ) );
+    if( 0 != hist->count )
+        restore( hist );
+}
+
+/** Drop an entry of a history that is not the newest.
+  * @param hist A valid history handle with duplicates table.
+  * @param slot Slot of the entry in the duplicates table. */
+static void drop( struct history* hist, int slot ) {
+    int const at = hist->cfg->dups[ slot ];
+    dupdel( hist, at, string( hist, at, result( hist ) ) );
+    unsigned char* const p = arena( hist ) + at;
+    p[1] |= dropped >> 8;
+    ++hist->dead;
+    hist->waste += sizeofentry( hist, at );
+    if( at == hist->oldest )
+        evict( hist );
+}
+
+/** Empty the duplicates table and the heads of the prefix index.
+  * @param hist A valid history handle. */
+static void clear( struct history* hist ) {
+    if( NULL != hist->cfg->heads )
+        for( int i = 0; i < HISTORY_LEVELS * hist->cfg->buckets; ++i )
+            hist->cfg->heads[i] = -1;
+    if( NULL != hist->cfg->dups )
+        for( int i = 0; i < hist->cfg->dupslots; ++i )
+            hist->cfg->dups[i] = -1;
+}
+
 /* Initialize an instance of a history. */
 void history_init( struct history* hist, struct historycfg const* cfg ) {
     hist->cfg = cfg;
     history_erase( hist );
-    typedef char(*array_t)[cfg->numlines][cfg->linelen];
-    array_t const lines = (array_t)cfg->lines;
-    for( int i = 0; i < cfg->numlines; ++i )
-        (*lines)[i][0] = '\0';
 }
 
 /*  Erase history. */
 void history_erase( struct history* hist ) {
-    typedef char(*array_t)[hist->cfg->numlines][hist->cfg->linelen];
-    array_t const lines = (array_t)hist->cfg->lines;
-    for( int i = 0; i < hist->cfg->numlines; ++i )
-        (*lines)[i][0] = '\0';
+    clear( hist );
     hist->oldest =  0;
     hist->newest = -1;
     hist->pos    = -1;
+    hist->seq    = -1;
+    hist->count  =  0;
+    hist->run    =  0;
+    hist->dead   =  0;
+    hist->waste  =  0;
+    hist->end    = arenasize( hist->cfg );
+}
+
+/* Get the oldest entry of a history. */
+char const* history_oldest( struct history* hist ) {
+    if( 0 == hist->count )
+        return NULL;
+    hist->walk = hist->oldest;
+    return string( hist, hist->oldest, result( hist ) );
+}
+
+/* Get the entry of a history after another one. */
+char const* history_newer( struct history* hist, char const* str ) {
+    int at = coded( hist->cfg ) ? hist->walk : str - (char const*)stored( hist, 0 );
+    if( at == hist->newest )
+        return NULL;
+    do {
+        at = next( hist, at );
+        if( coded( hist->cfg ) )
+            extend( hist, at, result( hist ) );
+    } while( dead( hist, at ) );
+    hist->walk = at;
+    return coded( hist->cfg ) ? result( hist ) : stored( hist, at );
+}
+
+/*
+ * Prefix index.
+ * Each entry is linked with the previous and the next entries that start
+ * with the same bytes, for prefixes of 1, 2, 4, 8 and 16 bytes. The heads
+ * are the newest entry for each hash of those prefixes, so entries with
+ * the same hash share a chain. The links are sequence numbers, so a link
+ * to an evicted entry is detected because it is older than the oldest.
+ * The links of the entry with a sequence number are in the position of
+ * its remainder by numlines, which is the maximum number of entries.
+ * A search follows the chain of the longest indexed prefix that is not
+ * longer than the key string and compares only the entries on it.
+ */
+
+/** Check if a sequence number is of an entry in a history.
+  * @param hist A valid history handle.
+  * @param seq  The sequence number. */
+static int valid( struct history const* hist, long seq ) {
+    return 0 <= seq && seq <= hist->seq && hist->seq - seq < hist->count;
+}
+
+/** Get the links of the entry with a sequence number.
+  * @param hist A valid history handle with index.
+  * @param seq  A valid sequence number. */
+static struct historylinks* linksof( struct history const* hist, long seq ) {
+    return &hist->cfg->links[ seq % hist->cfg->numlines ];
+}
+
+/** Get the longest prefix length indexed that is not longer than a key.
+  * @param len Length of the key. It is positive.
+  * @return The level of the prefix length. */
+static int level( int len ) {
+    int lev = 0;
+    while( lev + 1 < HISTORY_LEVELS && ( 2 << lev ) <= len )
+        ++lev;
+    return lev;
+}
+
+/** Get the head of the chain of a prefix.
+  * @param hist A valid history handle with index.
+  * @param lev  Level of the prefix length.
+  * @param str  String with 1 << lev bytes at least. */
+static long* head( struct history const* hist, int lev, char const* str ) {
+    int const bucket = hashof( str, 1 << lev ) & ( hist->cfg->buckets - 1 );
+    return &hist->cfg->heads[ lev * hist->cfg->buckets + bucket ];
+}
+
+/** Add the newest entry of a history to the prefix index.
+  * @param hist A valid history handle with index.
+  * @param str  The string of the newest entry.
+  * @param len  The length of the string. */
+static void link( struct history* hist, char const* str, int len ) {
+    struct historylinks* const links = linksof( hist, hist->seq );
+    links->at = hist->newest;
+    for( int lev = 0; lev < HISTORY_LEVELS; ++lev ) {
+        links->prev[lev] = -1;
+        links->next[lev] = -1;
+        if( len < 1 << lev )
+            continue;
+        long* const h = head( hist, lev, str );
+        if( valid( hist, *h ) ) {
+            links->prev[lev] = *h;
+            linksof( hist, *h )->next[lev] = hist->seq;
+        }
+        *h = hist->seq;
+    }
+}
+
+/** Check if the dropped entries of a history are worth a compaction.
+  * @param hist A valid history handle. */
+static int wasteful( struct history const* hist ) {
+    if( 0 == hist->dead )
+        return 0;
+    if( 4 * hist->waste >= arenasize( hist->cfg ) )
+        return 1;
+    return NULL != hist->cfg->links && 4 * hist->dead >= hist->cfg->numlines;
+}
+
+/** Remove the dropped entries of a history moving the live ones over them.
+  * The live entries are copied from the oldest to the newest back to back
+  * from the offset of the oldest, wrapping only when one does not fit at
+  * the end of the memory block, so all the room freed is together after
+  * the newest. An entry is never written over one not copied yet: before
+  * the wrap of the writing it goes where the entries read were, and after
+  * it, where the entries read after the wrap of the reading were. With
+  * front coding, the entries are decoded as they are read and coded again
+  * against the live entry before them, but the ones stored in full, the
+  * first live one after a dropped one stored in full and the one written at
+  * the start of the memory block are stored in full. They fit in the room
+  * of the entries before them: the characters they had in common with the
+  * entry before are characters stored in the entries since the last one
+  * stored in full. The duplicates table and the prefix index are built
+  * again with the new offsets.
+  * @param hist A valid history handle with dropped entries. */
+static void compact( struct history* hist ) {
+    int const qty = hist->count;
+    int const dedup = NULL != hist->cfg->dups;
+    int from = hist->oldest;
+    int to = hist->oldest;
+    int end = arenasize( hist->cfg );
+    int full = 1;
+    clear( hist );
+    hist->count = 0;
+    hist->dead  = 0;
+    hist->waste = 0;
+    hist->seq  -= qty;
+    for( int i = 0; i < qty; ++i ) {
+        int const after = from + sizeofentry( hist, from );
+        int const len = strlenof( hist, from );
+        int const common = prefix( hist, from );
+        char const* str = stored( hist, from );
+        if( coded( hist->cfg ) ) {
+            extend( hist, from, result( hist ) );
+            str = result( hist );
+        }
+        if( dead( hist, from ) )
+            full |= 0 == common;
+        else {
+            int same = 0;
+            if( !full && 0 != common ) {
+                char const* const last = scratch( hist );
+                while( same < len && last[ same ] == str[ same ] )
+                    ++same;
+            }
+            if( to + headsize( hist ) + len - same + 1 + 2 > arenasize( hist->cfg ) ) {
+                end  = to;
+                to   = 0;
+                same = 0;
+            }
+            put( hist, to, str, len, same );
+            if( !coded( hist->cfg ) )
+                str = stored( hist, to );
+            if( 0 == hist->count )
+                hist->oldest = to;
+            hist->run = 0 == same ? 0 : hist->run + 1;
+            hist->newest = to;
+            ++hist->count;
+            ++hist->seq;
+            if( dedup )
+                dupadd( hist, to, str, len );
+            if( NULL != hist->cfg->links )
+                link( hist, str, len );
+            if( coded( hist->cfg ) )
+                memcpy( scratch( hist ), str, len + 1 );
+            to += sizeofentry( hist, to );
+            full = 0;
+        }
+        from = after == hist->end ? 0 : after;
+    }
+    hist->end = end;
+    hist->pos = -1;
+}
+
+/** Make room for a new entry in a history evicting the oldest ones.
+  * @param hist A valid history handle.
+  * @param size Bytes of the new entry. Not more than the memory block.
+  * @return The offset for the new entry. */
+static int room( struct history* hist, int size ) {
+    int at = 0 == hist->count ? 0 : hist->newest + sizeofentry( hist, hist->newest );
+    for(;;) {
+        if( 0 == hist->count )
+            return 0;
+        if( hist->oldest >= at ) {
+            if( at + size <= hist->oldest )
+                return at;
+            if( wasteful( hist ) ) {
+                compact( hist );
+                at = hist->newest + sizeofentry( hist, hist->newest );
+            }
+            else
+                evict( hist );
+        }
+        else if( at + size <= arenasize( hist->cfg ) )
+            return at;
+        else {
+            hist->end = at;
+            at = 0;
+        }
+    }
+}
+
+/** Check if the prefix index can be used in a search from the last
+  * consulted entry, that is, if it starts like the key string.
+  * @param hist A valid history handle.
+  * @param text The key string.
+  * @param len  The length of key string. */
+static int indexed( struct history const* hist, char const* text, int len ) {
+    if( NULL == hist->cfg->links || 0 == len || 0 == hist->count )
+        return 0;
+    return 0 > hist->pos || 0 == strncmp( text, string( hist, hist->pos, scratch( hist ) ), 1 << level( len ) );
 }
 
 /*  Add a new line to a history. */
 void history_line( struct history* hist, char const* line ) {
-    typedef char(*array_t)[hist->cfg->numlines][hist->cfg->linelen];
-    array_t const lines = (array_t)hist->cfg->lines;
-    if( 0 <= hist->pos && 0 == strcmp( line, (*lines)[hist->pos] ) )
+    int const dedup = NULL != hist->cfg->dups;
+    if( !dedup && 0 <= hist->pos && 0 == strcmp( line, string( hist, hist->pos, scratch( hist ) ) ) )
         return;
-    int empty = -1 == hist->newest;
-    if( empty ) {
-        hist->oldest = 0;
-        hist->newest = 0;
+    int const extra = headsize( hist ) - 2 + overhead;
+    int len = strlen( line );
+    if( len > hist->cfg->linelen - 1 )
+        len = hist->cfg->linelen - 1;
+    if( len > arenasize( hist->cfg ) - extra )
+        len = arenasize( hist->cfg ) - extra;
+    if( 0 > len )
+        return;
+    if( dedup ) {
+        int const slot = dupfind( hist, line, len );
+        if( 0 <= slot && hist->cfg->dups[ slot ] == hist->newest ) {
+            hist->pos = -1;
+            return;
+        }
+        if( 0 <= slot )
+            drop( hist, slot );
     }
-    else {
-        if( ++hist->newest == hist->cfg->numlines )
-            hist->newest = 0;
-        if( hist->newest == hist->oldest && ++hist->oldest == hist->cfg->numlines )
-            hist->oldest = 0;
+    if( NULL != hist->cfg->links ) {
+        while( hist->count >= hist->cfg->numlines ) {
+            if( wasteful( hist ) )
+                compact( hist );
+            else
+                evict( hist );
+        }
+    }
+    int common = 0;
+    if( coded( hist->cfg ) && 0 != hist->count && hist->run < hist->cfg->restart ) {
+        char const* const last = string( hist, hist->newest, scratch( hist ) );
+        while( common < len && last[ common ] == line[ common ] )
+            ++common;
+    }
+    int at = room( hist, len - common + extra );
+    if( 0 != common && ( 0 == hist->count || 0 == at ) ) {
+        common = 0;
+        at = room( hist, len + extra );
     }
-    strncpy( (*lines)[ hist->newest ], line, sizeof **lines );
+    if( 0 == hist->count ) {
+        hist->oldest = at;
+        hist->end    = arenasize( hist->cfg );
+    }
+    put( hist, at, line, len, common );
+    hist->run = 0 == common ? 0 : hist->run + 1;
+    hist->newest = at;
+    ++hist->count;
+    ++hist->seq;
     hist->pos = -1;
+    if( dedup )
+        dupadd( hist, at, line, len );
+    if( NULL != hist->cfg->links )
+        link( hist, line, len );
+    if( NULL != hist->cfg->store )
+        hist->cfg->store( hist->cfg->p, line, len );
 }
 
 /** Get the previous history entry.
   * @param hist A valid history handle.
   * @return The previous history entry or null it the limit is got. */
 static char const* backward( struct history* hist ) {
-    if( -1 == hist->newest )
+    if( 0 == hist->count )
         return NULL;
-    typedef char(*array_t)[hist->cfg->numlines][hist->cfg->linelen];
-    array_t const lines = (array_t)hist->cfg->lines;
-    if( 0 > hist->pos )
-        hist->pos = hist->newest;
-    else if( hist->pos != hist->oldest )
-        if( --hist->pos < 0 )
-            hist->pos = hist->cfg->numlines - 1;
-    return (*lines)[hist->pos];
+    if( 0 > hist->pos ) {
+        hist->pos  = hist->newest;
+        hist->pseq = hist->seq;
+    }
+    else if( hist->pos != hist->oldest ) {
+        do {
+            hist->pos = prev( hist, hist->pos );
+            --hist->pseq;
+        } while( dead( hist, hist->pos ) );
+    }
+    return string( hist, hist->pos, result( hist ) );
+}
+
+/** Search the previous matching entry with the prefix index.
+  * It ends in the same entry as the search one by one.
+  * @param hist A valid history handle with index.
+  * @param text The key string for searching.
+  * @param len  The length of key string.
+  * @return  The previous matching entry or null if not found. */
+static char const* jumpbackward( struct history* hist, char const* text, int len ) {
+    int const lev = level( len );
+    long seq = 0 > hist->pos ? *head( hist, lev, text ) : linksof( hist, hist->pseq )->prev[lev];
+    for( ; valid( hist, seq ); seq = linksof( hist, seq )->prev[lev] ) {
+        int const at = linksof( hist, seq )->at;
+        if( !dead( hist, at ) && 0 == strncmp( text, string( hist, at, scratch( hist ) ), len ) ) {
+            hist->pos  = at;
+            hist->pseq = seq;
+            return string( hist, at, result( hist ) );
+        }
+    }
+    int const limit = hist->pos == hist->oldest;
+    hist->pos  = hist->oldest;
+    hist->pseq = hist->seq - hist->count + 1;
+    char const* const oldest = string( hist, hist->oldest, result( hist ) );
+    return limit && 0 == strncmp( text, oldest, len ) ? oldest : NULL;
 }
 
 /* It searches in a history the previous matching entry. */
 char const* history_backward( struct history* hist, char const* text, int len ) {
+    if( indexed( hist, text, len ) )
+        return jumpbackward( hist, text, len );
     for(;;) {
         int const limit = hist->pos == hist->oldest;
         char const* rslt = backward( hist );
         if ( NULL == rslt )
             return NULL;
-        if ( 0 == memcmp( text, rslt, len ) )
+        if ( 0 == strncmp( text, rslt, len ) )
             return rslt;
         if ( limit )
             return NULL;
@@ -99,26 +747,141 @@ char const* history_backward( struct history* hist, char const* text, int len )
   * @param hist A valid history handle.
   * @return The next history entry or null it the limit is got. */
 static char const* forward( struct history* hist ) {
-    if( -1 == hist->newest )
+    if( 0 == hist->count )
         return NULL;
     if( hist->pos == hist->newest )
         return NULL;
-    typedef char(*array_t)[hist->cfg->numlines][hist->cfg->linelen];
-    array_t const lines = (array_t)hist->cfg->lines;
-    if( 0 > hist->pos )
+    if( 0 > hist->pos ) {
+        hist->pos  = hist->newest;
+        hist->pseq = hist->seq;
+    }
+    else {
+        do {
+            hist->pos = next( hist, hist->pos );
+            ++hist->pseq;
+        } while( dead( hist, hist->pos ) );
+    }
+    return string( hist, hist->pos, result( hist ) );
+}
+
+/** Search the next matching entry with the prefix index.
+  * It ends in the same entry as the search one by one.
+  * @param hist A valid history handle with index.
+  * @param text The key string for searching.
+  * @param len  The length of key string.
+  * @return  The next matching entry or null if not found. */
+static char const* jumpforward( struct history* hist, char const* text, int len ) {
+    if( hist->pos == hist->newest )
+        return NULL;
+    hist->pseq = 0 > hist->pos ? hist->seq : hist->pseq;
+    if( 0 > hist->pos ) {
         hist->pos = hist->newest;
-    else if( ++hist->pos == hist->cfg->numlines )
-        hist->pos = 0;
-    return (*lines)[hist->pos];
+        char const* const newest = string( hist, hist->newest, result( hist ) );
+        return 0 == strncmp( text, newest, len ) ? newest : NULL;
+    }
+    int const lev = level( len );
+    long seq = linksof( hist, hist->pseq )->next[lev];
+    for( ; valid( hist, seq ); seq = linksof( hist, seq )->next[lev] ) {
+        int const at = linksof( hist, seq )->at;
+        if( !dead( hist, at ) && 0 == strncmp( text, string( hist, at, scratch( hist ) ), len ) ) {
+            hist->pos  = at;
+            hist->pseq = seq;
+            return string( hist, at, result( hist ) );
+        }
+    }
+    hist->pos  = hist->newest;
+    hist->pseq = hist->seq;
+    return NULL;
 }
 
 /* It searches in a history the next matching entry. */
 char const* history_forward( struct history* hist, char const* text, int len ) {
+    if( indexed( hist, text, len ) )
+        return jumpforward( hist, text, len );
     for(;;) {
         char const* rslt = forward( hist );
         if ( NULL == rslt )
             return NULL;
-        if ( 0 == memcmp( text, rslt, len ) )
+        if ( 0 == strncmp( text, rslt, len ) )
             return rslt;
     }
 }
+
+/*
+ * Substring search.
+ * The entries are visited from the newest to the oldest with their length
+ * fields, so their lengths are not counted and, without front coding, the
+ * entries are not copied. In each one the key string is searched with the
+ * algorithm of Horspool: the last character of the window selects how far
+ * the window jumps, so most characters of the entries are never compared.
+ * The table of jumps is built once for each search.
+ */
+
+/** Build the table of jumps of the algorithm of Horspool.
+  * @param shift Destination of the jumps for each value of a character.
+  * @param text  The key string.
+  * @param len   The length of the key string. Positive. */
+static void horspool( int* shift, char const* text, int len ) {
+    for( int i = 0; i <= UCHAR_MAX; ++i )
+        shift[i] = len;
+    for( int i = 0; i < len - 1; ++i )
+        shift[ (unsigned char)text[i] ] = len - 1 - i;
+}
+
+/** Find a key string in a string with the algorithm of Horspool.
+  * @param str     The string.
+  * @param len     The length of the string.
+  * @param text    The key string.
+  * @param textlen The length of the key string. Positive.
+  * @param shift   The table of jumps of the key string.
+  * @return The position of the first match or -1 if not found. */
+static int find( char const* str, int len, char const* text, int textlen, int const* shift ) {
+    unsigned char const last = text[ textlen - 1 ];
+    for( int i = 0; i + textlen <= len; ) {
+        unsigned char const c = str[ i + textlen - 1 ];
+        if( c == last && 0 == memcmp( str + i, text, textlen - 1 ) )
+            return i;
+        i += shift[ c ];
+    }
+    return -1;
+}
+
+/* It searches in a history the previous entry that contains a string. */
+char const* history_search( struct history* hist, char const* text, int len, int older, int* at ) {
+    if( 0 == hist->count )
+        return NULL;
+    int pos = hist->pos;
+    long seq = hist->pseq;
+    if( 0 > pos ) {
+        pos = hist->newest;
+        seq = hist->seq;
+    }
+    else if( older ) {
+        if( pos == hist->oldest )
+            return NULL;
+        do {
+            pos = prev( hist, pos );
+            --seq;
+        } while( dead( hist, pos ) );
+    }
+    int shift[ UCHAR_MAX + 1 ];
+    if( 0 < len )
+        horspool( shift, text, len );
+    for(;;) {
+        if( !dead( hist, pos ) ) {
+            char const* const str = string( hist, pos, scratch( hist ) );
+            int const found = 0 == len ? 0 : find( str, strlenof( hist, pos ), text, len, shift );
+            if( 0 <= found ) {
+                hist->pos  = pos;
+                hist->pseq = seq;
+                if( NULL != at )
+                    *at = found;
+                return string( hist, pos, result( hist ) );
+            }
+        }
+        if( pos == hist->oldest )
+            return NULL;
+        pos = prev( hist, pos );
+        --seq;
+    }
+}
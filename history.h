@@ -27,19 +27,70 @@
 extern "C" {
 #endif
 
+/** Number of prefix lengths in the index of a history: 1, 2, 4, 8 and 16. */
+#define HISTORY_LEVELS 5
+
+/** Links of a history entry in the prefix index. For internal use. */
+struct historylinks {
+    long prev[ HISTORY_LEVELS ]; /**< Previous entry with the same start. */
+    long next[ HISTORY_LEVELS ]; /**< Next entry with the same start.     */
+    int at;                      /**< Offset of the entry.                */
+};
+
 /** History configuration. */
 struct historycfg {
-    void* lines;    /**< Memory block for history.  */
-    short linelen;  /**< Length of lines in history. */
-    short numlines; /**< Lines capacity in history.  */
+    /** Memory block for history. The entries are packed in it, each one
+      * takes the length of its string plus five bytes. The oldest entries
+      * are evicted when there is no room for a new one. */
+    void* lines;
+    short linelen;  /**< Maximum length of lines, null character included. */
+    /** Maximum number of entries with the prefix index. Without the index
+      * it is only used to size the memory block when size is zero. */
+    int numlines;
+    int size;       /**< Bytes of memory block or zero for numlines * linelen. */
+    /** Array of numlines links for the prefix index or null for no index.
+      * With the index, the search of entries that start with a prefix jumps
+      * from one to the next instead of comparing each entry. */
+    struct historylinks* links;
+    /** Array of HISTORY_LEVELS times buckets heads for the prefix index. */
+    long* heads;
+    /** Number of buckets for each prefix length. A power of two, usually
+      * not less than numlines. */
+    int buckets;
+    /** Array of dupslots offsets to drop the duplicated entries or null to
+      * keep them. With it, a line that is in the history is moved to the
+      * newest position instead of being stored again. */
+    int* dups;
+    /** Number of slots of the duplicates table. A power of two greater than
+      * the maximum number of entries, size / 5 or numlines with index. */
+    int dupslots;
+    /** Function called with each line stored in the history, for example
+      * histlog_store() to make it persistent, or null. */
+    void (*store)( void* p, char const* line, int len );
+    void* p; /**< Parameter of the store function. */
+    /** Maximum number of consecutive entries stored with front coding or
+      * zero to store all of them in full. With front coding, an entry only
+      * stores the characters that it has not in common with the start of
+      * the entry before it, and the first 2 * linelen bytes of the memory
+      * block are used to decode the entries. Then an entry returned is
+      * valid until the next call to a function of the history. */
+    int restart;
 };
 
 /** It handles a history. */
 struct history {
     struct historycfg const* cfg;
-    short oldest; /**< Index of the oldest entry.         */
-    short newest; /**< Index if the newest entry.         */
-    short pos;    /**< Index of the last consulted entry. */
+    int oldest; /**< Offset of the oldest entry.            */
+    int newest; /**< Offset of the newest entry.            */
+    int pos;    /**< Offset of the last consulted entry.    */
+    int end;    /**< End of the entries before a wrap.      */
+    int count;  /**< Number of entries, dropped included.   */
+    long seq;   /**< Sequence number of the newest entry.   */
+    long pseq;  /**< Sequence number of the consulted entry. */
+    int run;    /**< Entries with front coding since a full one. */
+    int walk;   /**< Offset of the last entry walked.        */
+    int dead;   /**< Number of entries dropped.              */
+    int waste;  /**< Bytes of the entries dropped.           */
 };
 
 /** Initialize an instance of a history.
@@ -56,7 +107,22 @@ void history_erase( struct history* hist );
   * @param line Null-terminated string with the new line to be added. */
 void history_line( struct history* hist, char const* line );
 
+/** Get the oldest entry of a history, to walk all its entries.
+  * @param hist A valid history handle.
+  * @return The oldest entry or null if the history is empty. */
+char const* history_oldest( struct history* hist );
+
+/** Get the entry of a history after another one.
+  * With front coding the entries are decoded in the same buffer, so str
+  * has to be the last entry returned by the history.
+  * @param hist A valid history handle.
+  * @param str An entry returned by history_oldest() or by this function.
+  * @return The next entry or null if str is the newest. */
+char const* history_newer( struct history* hist, char const* str );
+
 /** It searches in a history the previous matching entry.
+  * With the prefix index it only visits the entries that start like the
+  * key string, up to its first 16 bytes.
   * @param hist A valid history handle.
   * @param text The key string for searching.
   * @param len  The lengthy of key string.
@@ -64,26 +130,40 @@ void history_line( struct history* hist, char const* line );
 char const* history_backward( struct history* hist, char const* text, int len );
 
 /** It searches in a history the next matching entry.
+  * With the prefix index it only visits the entries that start like the
+  * key string, up to its first 16 bytes.
   * @param hist A valid history handle.
   * @param text The key string for searching.
   * @param len  The lengthy of key string.
   * @return  The next matching entry or null if not found. */
 char const* history_forward( struct history* hist, char const* text, int len );
 
+/** It searches in a history the previous entry that contains a string.
+  * The entries are searched from the last consulted one or from the newest
+  * if there is not, so an incremental search goes on where it stopped.
+  * @param hist  A valid history handle.
+  * @param text  The key string for searching.
+  * @param len   The length of key string.
+  * @param older Non-zero to start from the entry before the last consulted
+  *              one, zero to start from it.
+  * @param at    Destination of the position of the match in the entry or null.
+  * @return The matching entry or null if not found. Then the last consulted
+  *         entry does not change. */
+char const* history_search( struct history* hist, char const* text, int len, int older, int* at );
 
 /* Example:
  *
  *   enum {
- *       numlines = 64,
- *       linelen  = 80
+ *       size    = 4096,
+ *       linelen = 80
  *   };
  *
- *   char memory[numlines][linelen];
+ *   char memory[size];
  *
  *   static struct historycfg const cfg = {
- *       .lines    = memory,
- *       .linelen  = linelen,
- *       .numlines = numlines
+ *       .lines   = memory,
+ *       .linelen = linelen,
+ *       .size    = size
  *   };
  *
  *   struct history his;
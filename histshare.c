@@ -0,0 +1,124 @@
+
+/*
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+  SPDX-License-Identifier: MIT
+  Copyright (c) 2018 Rafa Garcia <rafagarcia77@gmail.com>.
+  Permission is hereby  granted, free of charge, to any  person obtaining a copy
+  of this software and associated  documentation files (the "Software"), to deal
+  in the Software  without restriction, including without  limitation the rights
+  to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+  copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+  IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+  FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+  AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+  LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+/*
+ * The sessions publish their lines in a ring of slots. A publisher takes a
+ * ticket with an atomic increment and the slot of the ticket in the ring,
+ * and marks it as written before copying the line and as published after
+ * it, both with a compare and swap from the state it expects. A publisher
+ * that finds its slot taken by a newer ticket drops its line, which would
+ * be overwritten anyway, and so does one that finds its slot still being
+ * written by another publisher, that was lapped or is slow, so two copies
+ * never overlap and the publishers never wait. As the states only change
+ * from the one that each publisher expects, a publisher never overwrites
+ * the state of a newer one.
+ * The sessions read the slots like a sequence lock: a line is copied only
+ * if the slot is published with its ticket before and after the copy, so
+ * the readers never block the publishers. A reader skips the lines that
+ * were overwritten and retries later from a slot that an older ticket
+ * still has, as its publisher may yet take it. If it dropped its line
+ * instead, the lines after it are copied once the ring laps it. Each
+ * session copies the lines in its own history, so its navigation and
+ * searches do not touch the ring.
+ * The tickets and the states of the slots use the __atomic builtins of
+ * GCC and Clang, the copies of the lines are plain memcpy().
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "histshare.h"
+
+/* Initialize a shared history ring. */
+void histshare_init( struct histshare* share, struct histsharecfg const* cfg ) {
+    share->cfg = cfg;
+    for( int i = 0; i < cfg->numslots; ++i ) {
+        cfg->slots[i].state = 0;
+        cfg->slots[i].owner = NULL;
+    }
+    __atomic_store_n( &share->head, 0, __ATOMIC_SEQ_CST );
+}
+
+/* Initialize a session of a shared history ring. */
+void histshare_session( struct histsession* session, struct histshare* share, struct history* hist ) {
+    session->share   = share;
+    session->hist    = hist;
+    session->next    = 0;
+    session->pulling = 0;
+}
+
+/* Publish a line stored in the history of a session. */
+void histshare_store( void* p, char const* line, int len ) {
+    struct histsession* const session = p;
+    if( session->pulling )
+        return;
+    struct histsharecfg const* const cfg = session->share->cfg;
+    long const ticket = __atomic_fetch_add( &session->share->head, 1, __ATOMIC_SEQ_CST );
+    int const index = ticket & ( cfg->numslots - 1 );
+    struct histslot* const slot = &cfg->slots[ index ];
+    long const written = 2 * ticket + 1;
+    long state = __atomic_load_n( &slot->state, __ATOMIC_ACQUIRE );
+    do {
+        if( state > 2 * ticket || 0 != state % 2 )
+            return;
+    } while( !__atomic_compare_exchange_n( &slot->state, &state, written, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) );
+    if( len > cfg->linelen - 1 )
+        len = cfg->linelen - 1;
+    char* const dest = cfg->lines + index * cfg->linelen;
+    memcpy( dest, line, len );
+    dest[ len ] = '\0';
+    __atomic_store_n( &slot->owner, session, __ATOMIC_RELAXED );
+    long expected = written;
+    __atomic_compare_exchange_n( &slot->state, &expected, written + 1, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED );
+}
+
+/* Add to the history of a session the lines published by other sessions. */
+int histshare_pull( struct histsession* session ) {
+    struct histsharecfg const* const cfg = session->share->cfg;
+    long const head = __atomic_load_n( &session->share->head, __ATOMIC_ACQUIRE );
+    if( session->next < head - cfg->numslots )
+        session->next = head - cfg->numslots;
+    char line[ cfg->linelen ];
+    int qty = 0;
+    session->pulling = 1;
+    for( ; session->next < head; ++session->next ) {
+        int const index = session->next & ( cfg->numslots - 1 );
+        struct histslot* const slot = &cfg->slots[ index ];
+        long const published = 2 * session->next + 2;
+        long const state = __atomic_load_n( &slot->state, __ATOMIC_ACQUIRE );
+        if( state < published )
+            break; // It is not published yet or an older ticket still has it
+        if( state > published )
+            continue; // It was overwritten
+        void const* const owner = __atomic_load_n( &slot->owner, __ATOMIC_RELAXED );
+        memcpy( line, cfg->lines + index * cfg->linelen, cfg->linelen );
+        __atomic_thread_fence( __ATOMIC_ACQUIRE );
+        if( state != __atomic_load_n( &slot->state, __ATOMIC_RELAXED ) )
+            continue;
+        line[ cfg->linelen - 1 ] = '\0';
+        if( owner != session ) {
+            history_line( session->hist, line );
+            ++qty;
+        }
+    }
+    session->pulling = 0;
+    return qty;
+}
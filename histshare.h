@@ -0,0 +1,97 @@
+
+/*
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+  SPDX-License-Identifier: MIT
+  Copyright (c) 2018 Rafa Garcia <rafagarcia77@gmail.com>.
+  Permission is hereby  granted, free of charge, to any  person obtaining a copy
+  of this software and associated  documentation files (the "Software"), to deal
+  in the Software  without restriction, including without  limitation the rights
+  to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+  copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+  IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+  FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+  AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+  LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#ifndef HISTSHARE_H
+#define HISTSHARE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include "history.h"
+
+/** Slot of a shared history ring. For internal use. */
+struct histslot {
+    /** Twice the ticket of its line plus one while the line is written or
+      * plus two once it is published, zero if it was never used. */
+    long state;
+    void const* owner; /**< Session that published the line. */
+};
+
+/** Shared history ring configuration. */
+struct histsharecfg {
+    struct histslot* slots; /**< Array of numslots slots.                    */
+    char* lines;            /**< Memory block of numslots lines of linelen.  */
+    int numslots;           /**< Number of slots. A power of two.            */
+    short linelen;          /**< Length of lines, null character included.   */
+};
+
+/** Ring of the last lines of many sessions. */
+struct histshare {
+    struct histsharecfg const* cfg;
+    long head; /**< Ticket of the next line. For internal use. */
+};
+
+/** Session of a shared history ring. It has its own history, which keeps
+  * its own navigation, and it copies in it the lines of the other sessions. */
+struct histsession {
+    struct histshare* share; /**< The shared history ring.           */
+    struct history* hist;    /**< History of the session.            */
+    long next;               /**< Ticket of the next line to copy.   */
+    int pulling;             /**< The lines of the ring are copied.  */
+};
+
+/** Initialize a shared history ring.
+  * @param share The shared history ring.
+  * @param cfg   Configuration. */
+void histshare_init( struct histshare* share, struct histsharecfg const* cfg );
+
+/** Initialize a session of a shared history ring.
+  * The history configuration has to have histshare_store as store function
+  * and the session handle as its parameter, so that each line added to the
+  * history is published to the other sessions.
+  * @param session The session handle.
+  * @param share   The shared history ring.
+  * @param hist    A valid history handle for the session. */
+void histshare_session( struct histsession* session, struct histshare* share, struct history* hist );
+
+/** Publish a line stored in the history of a session.
+  * It is the store function of the history configuration. It does not
+  * lock nor wait for the other sessions.
+  * @param p    The session handle.
+  * @param line The line.
+  * @param len  The length of the line. */
+void histshare_store( void* p, char const* line, int len );
+
+/** Add to the history of a session the lines published by other sessions
+  * since the last call. The lines overwritten in the ring meanwhile are
+  * lost. It stops at a line that is not published yet and goes on from it
+  * in the next call. It does not lock nor make the publishers wait.
+  * @param session The session handle.
+  * @return The number of lines added. */
+int histshare_pull( struct histsession* session );
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* HISTSHARE_H */
@@ -43,6 +43,17 @@ int tputc( int c, void* p );
   *          On error, -1 is returned. */
 int tputs( char const* str, void* p );
 
+/** Callback function. It has to be defined by the user.
+  * It prints an array of characters to a terminal.
+  * vt100-iface collects all the output of a received character and
+  * sends it at once with this function.
+  * @param buf Characters to be sent.
+  * @param len Number of characters to be sent.
+  * @param p   A valid instance of a terminal.
+  * @return  On success, a non-negative value is returned.
+  *          On error, -1 is returned. */
+int tputn( char const* buf, int len, void* p );
+
 /** Callback function. It optionally has to be defined by the user.
   * Get blocked until get a character from a terminal.
   * @param p A valid instance of a terminal.
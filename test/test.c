@@ -25,10 +25,17 @@
 #include <string.h>
 #include <stdint.h>
 #include <ctype.h>
+#include <stdlib.h>
+#include <pthread.h>
 
 #include "../vt100.h"
 #include "../clarg.h"
+#include "../histlog.h"
+#include "../histshare.h"
+#include "../ascii.h"
+#include "../utf8.h"
 #include "../terminal-io.h"
+#include "words.h"
 
 enum {
     verbose = 0
@@ -84,6 +91,7 @@ struct stream {
     int iout;
     char const* input;
     int iin;
+    int writes;
 };
 
 int tputc( int c, void* p ) {
@@ -103,9 +111,17 @@ int tputs( char const* str, void* p ) {
     return 0;
 }
 
+int tputn( char const* buf, int len, void* p ) {
+    struct stream* stream = (struct stream*)p;
+    ++stream->writes;
+    for( int i = 0; i < len; ++i )
+        tputc( buf[i], p );
+    return 0;
+}
+
 int tgetc( void* p ) {
     struct stream* stream = (struct stream*)p;
-    int const rslt = stream->input[ stream->iin ];
+    int const rslt = (unsigned char)stream->input[ stream->iin ];
     if( '\0' == rslt )
         return -1;
     ++stream->iin;
@@ -125,6 +141,81 @@ static void presult( struct stream const* stream, char const* line ) {
     printf( "\n" );
 }
 
+/** Get the columns of a code point in a terminal for the characters of the tests.
+  * @param cp The code point.
+  * @return 0, 1 or 2. */
+static int testwidth( unsigned cp ) {
+    if( 0x300 <= cp && cp < 0x370 )
+        return 0;
+    if( ( 0x2E80 <= cp && cp < 0xA4D0 ) || ( 0xAC00 <= cp && cp < 0xD7A4 ) )
+        return 2;
+    return 1;
+}
+
+/** Reproduce in a screen line what a terminal does with the output.
+  * Each column is a cell with a character and its combining marks.
+  * @param output Null-terminated output of a line capture.
+  * @param screen Destination. Null-terminated string with the visible text.
+  * @param max    Size of screen buffer.
+  * @return Column of the cursor. */
+static int emulate( char const* output, char* screen, int max ) {
+    enum { maxcols = 128 };
+    static char cells[ maxcols ][ 16 ];
+    int col = 0;
+    int len = 0;
+    while( '\0' != *output ) {
+        int const c = *output++;
+        if( '\033' == c && '[' == *output ) {
+            ++output;
+            int n = 0;
+            for( ; '?' == *output || isdigit( (unsigned char)*output ); ++output )
+                if( '?' != *output )
+                    n = 10 * n + *output - '0';
+            int const cmd = *output++;
+            if( 0 == n )
+                n = 1;
+            if( 'C' == cmd )
+                col += n;
+            else if( 'D' == cmd )
+                col -= n;
+            else if( 'K' == cmd && col < len )
+                len = col;
+        }
+        else if( '\b' == c )
+            --col;
+        else if( '\r' == c || '\n' == c )
+            col = len = 0;
+        else if( col < maxcols - 2 ) {
+            unsigned cp;
+            int seqlen = utf8_decode( output - 1, strlen( output - 1 ), &cp );
+            if( 0 >= seqlen )
+                seqlen = 1;
+            char const* const seq = output - 1;
+            output += seqlen - 1;
+            int const width = testwidth( cp );
+            if( 0 == width ) {
+                if( 0 < col )
+                    strncat( cells[ col - 1 ], seq, seqlen );
+                continue;
+            }
+            for( ; len < col; ++len )
+                strcpy( cells[len], " " );
+            memcpy( cells[col], seq, seqlen );
+            cells[col][seqlen] = '\0';
+            if( 2 == width )
+                cells[col+1][0] = '\0';
+            col += width;
+            if( len < col )
+                len = col;
+        }
+    }
+    screen[0] = '\0';
+    for( int i = 0; i < len; ++i )
+        if( strlen( screen ) + strlen( cells[i] ) < max )
+            strcat( screen, cells[i] );
+    return col;
+}
+
 static int processline( char const* input, char* line, int sizeline, struct hints const* hints ) {
     struct stream stream;
     memset( &stream, 0, sizeof stream );
@@ -233,6 +324,29 @@ static int delete( void ) {
     done();
 }
 
+static int sequences( void ) {
+    static char const input[] = "Three\033]0;window title\007\033[H\033P1$r\033\\"
+                                "One \033[F\033[1;5D\033[?25hTwo \033[2;2;2;2;2C\n";
+    static char const expected[] = "One Two Three";
+    char line[ 128 ];
+    int const len = processline( input, line, sizeof line, NULL );
+    check( len == sizeof expected - 1 );
+    check( 0 == strcmp( line, expected ) );
+    struct stream stream;
+    memset( &stream, 0, sizeof stream );
+    struct vt100 const vt100 = {
+        .p     = &stream,
+        .line  = line,
+        .max   = sizeof line,
+    };
+    struct vt100state st;
+    vt100_init( &st, &vt100, echo_on );
+    int const feedlen = vt100_feed( &st, input, sizeof input - 1, NULL );
+    check( feedlen == sizeof expected - 1 );
+    check( 0 == strcmp( line, expected ) );
+    done();
+}
+
 static int home( void ) {
     static char const input[]    = "Two Three" HOME "One \n";
     static char const expected[] = "One Two Three";
@@ -288,6 +402,815 @@ static int hintBackward( void ) {
     done();
 }
 
+static int hintIndex( void ) {
+    static char const* const words [] = {
+        "two", "ten", "three", "t", "one", "tree", "thirty", "three", "", "six"
+    };
+    enum { qty = sizeof words / sizeof *words };
+    int index[ qty ];
+    struct hints linear = {
+        .str = words,
+        .qty = qty
+    };
+    hints_index( &linear, index );
+    for( int i = 1; i < qty; ++i )
+        check( 0 > strcmp( words[ index[i-1] ], words[ index[i] ] ) ||
+             ( 0 == strcmp( words[ index[i-1] ], words[ index[i] ] ) && index[i-1] < index[i] ) );
+    struct hints indexed = linear;
+    indexed.index = index;
+    static char const* const prefixes [] = { "t", "th", "thr", "three", "threes", "x", "o", "" };
+    for( int p = 0; p < sizeof prefixes / sizeof *prefixes; ++p ) {
+        int const len = strlen( prefixes[p] );
+        for( int h = 0; h < qty; ++h ) {
+            int const next = hints_next( &linear, prefixes[p], len, h );
+            int const prev = hints_prev( &linear, prefixes[p], len, h );
+            check( next == hints_next( &indexed, prefixes[p], len, h ) );
+            check( prev == hints_prev( &indexed, prefixes[p], len, h ) );
+            check( 0 > next || 0 == strncmp( words[next], prefixes[p], len ) );
+        }
+    }
+    check( 2 == hints_next( &indexed, "thr", 3, 0 ) );
+    check( 7 == hints_next( &indexed, "thr", 3, 2 ) );
+    check( 2 == hints_next( &indexed, "thr", 3, 7 ) );
+    check( 7 == hints_prev( &indexed, "thr", 3, 2 ) );
+    check( -1 == hints_next( &indexed, "one", 3, 4 ) );
+    check( -1 == hints_next( &indexed, "x", 1, 0 ) );
+    static char const input[] = "t" TAB TAB TAB SHIFT_TAB "\n";
+    char line[ 128 ];
+    int const len = processline( input, line, sizeof line, &indexed );
+    check( len == sizeof "three" - 1 );
+    check( 0 == strcmp( line, "three" ) );
+    done();
+}
+
+static int hintCommon( void ) {
+    static char const* const words [] = {
+        "interface eth0", "show", "interface eth1", "shutdown", "int", "ip route",
+        "\xC3\xA9t\xC3\xA9", "\xC3\xA8re"
+    };
+    enum { qty = sizeof words / sizeof *words };
+    int index[ qty ];
+    struct hints hints = {
+        .str = words,
+        .qty = qty
+    };
+    for( int indexed = 0; indexed < 2; ++indexed ) {
+        if( indexed ) {
+            hints_index( &hints, index );
+            hints.index = index;
+        }
+        int first;
+        check( 4 == hints_count( &hints, "i", 1, &first ) );
+        check( indexed ? 0 == first : -1 == first );
+        check( 2 == hints_count( &hints, "sh", 2, NULL ) );
+        check( 0 == hints_count( &hints, "x", 1, NULL ) );
+        check( qty == hints_count( &hints, "", 0, NULL ) );
+        char const* hint;
+        check( 3 == hints_common( &hints, "in", 2, &hint ) );
+        check( 0 == strncmp( hint, "int", 3 ) );
+        check( 2 == hints_common( &hints, "s", 1, NULL ) );
+        check( 8 == hints_common( &hints, "ip", 2, &hint ) );
+        check( 0 == strcmp( hint, "ip route" ) );
+        check( -1 == hints_common( &hints, "x", 1, &hint ) );
+        check( NULL == hint );
+        static char const* const inputs [] = {
+            "in" TAB "e" TAB TAB "\n",
+            "sh" TAB "o" TAB "\n",
+            "\xC3\xA9" TAB "\n",
+            "shutdown" TAB TAB "\n"
+        };
+        static char const* const expected [] = {
+            "interface eth1",
+            "show",
+            "\xC3\xA9t\xC3\xA9",
+            "shutdown",
+        };
+        for( int i = 0; i < sizeof inputs / sizeof *inputs; ++i ) {
+            char line[ 128 ];
+            processline( inputs[i], line, sizeof line, &hints );
+            check( 0 == strcmp( line, expected[i] ) );
+        }
+    }
+    /* The common prefix is not extended to a part of a character. */
+    struct hints const accents = {
+        .str = words + qty - 2,
+        .qty = 2
+    };
+    char line[ 128 ];
+    processline( TAB "\n", line, sizeof line, &accents );
+    check( 0 == strcmp( line, "\xC3\xA8re" ) );
+    done();
+}
+
+static int hintFuzzy( void ) {
+    static char const* const words [] = {
+        "commit", "checkout", "clone-mirror", "cm", "config", "xcmd"
+    };
+    struct hints const hints = {
+        .str = words,
+        .qty = sizeof words / sizeof *words
+    };
+    check( 0 == hints_score( "checkout", "cm", 2 ) );
+    check( hints_score( "cm", "cm", 2 ) > hints_score( "xcmd", "cm", 2 ) );
+    check( hints_score( "xcmd", "cm", 2 ) > hints_score( "commit", "cm", 2 ) );
+    check( hints_score( "cmt", "cmt", 3 ) > hints_score( "cm-t", "cmt", 3 ) );
+    check( hints_score( "cm-t", "cmt", 3 ) > hints_score( "c-m-t", "cmt", 3 ) );
+    check( 0 < hints_score( "c-m-t", "cmt", 3 ) );
+    check( 0 < hints_score( "aaa", "aa", 2 ) && 0 == hints_score( "a-b", "aa", 2 ) );
+    check( 3 == hints_fuzzynext( &hints, "cm", 2, -1 ) );
+    check( 5 == hints_fuzzynext( &hints, "cm", 2, 3 ) );
+    check( 0 == hints_fuzzynext( &hints, "cm", 2, 5 ) );
+    check( 2 == hints_fuzzynext( &hints, "cm", 2, 0 ) );
+    check( 3 == hints_fuzzynext( &hints, "cm", 2, 2 ) );
+    check( 2 == hints_fuzzyprev( &hints, "cm", 2, -1 ) );
+    check( 0 == hints_fuzzyprev( &hints, "cm", 2, 2 ) );
+    check( -1 == hints_fuzzynext( &hints, "zz", 2, -1 ) );
+    static char const* const inputs [] = {
+        "cm" TAB "\n",
+        "cm" TAB TAB "\n",
+        "cm" TAB TAB TAB TAB TAB "\n",
+        "cm" SHIFT_TAB "\n",
+        "cm" TAB TAB SHIFT_TAB "\n",
+        "zz" TAB "\n",
+        "cm" TAB "d" TAB "\n"
+    };
+    static char const* const expected [] = {
+        "cm", "xcmd", "cm", "clone-mirror", "cm", "zz", "xcmd"
+    };
+    for( int i = 0; i < sizeof inputs / sizeof *inputs; ++i ) {
+        struct stream stream;
+        memset( &stream, 0, sizeof stream );
+        stream.input = inputs[i];
+        char line[ 128 ];
+        struct vt100 const vt100 = {
+            .p     = &stream,
+            .line  = line,
+            .max   = sizeof line,
+            .hints = &hints,
+            .fuzzy = 1
+        };
+        vt100_getline( &vt100, echo_on );
+        if( verbose )
+            presult( &stream, line );
+        check( 0 == strcmp( line, expected[i] ) );
+    }
+    done();
+}
+
+static int hintTree( void ) {
+    static char const line[] = "ab  \"c d\\\" e\"f \"g";
+    static int const starts[] = { 0, 5, 13, 16 };
+    static int const lens[] = { 2, 7, 1, 1 };
+    int pos = 0;
+    for( int i = 0; i < sizeof starts / sizeof *starts; ++i ) {
+        int arg;
+        check( lens[i] == clarg_find( line, sizeof line - 1, &pos, &arg ) );
+        check( starts[i] == arg );
+    }
+    check( sizeof line - 1 == pos );
+    check( -1 == clarg_find( line, sizeof line - 1, &pos, NULL ) );
+
+    static char const* const commands [] = { "echo", "sum", "exit" };
+    static char const* const onoff [] = { "on", "off" };
+    static char const* const usage [] = { "help" };
+    struct hints const echoargs = { .str = onoff, .qty = 2 };
+    struct hints const sumargs = { .str = usage, .qty = 1 };
+    struct hintnode const echonode = { .hints = &echoargs };
+    struct hintnode const sumnode = { .hints = &sumargs };
+    struct hintnode const* const next [] = { &echonode, &sumnode, NULL };
+    struct hints const hints = { .str = commands, .qty = 3 };
+    struct hintnode const tree = { .hints = &hints, .next = next };
+    int word;
+    check( &hints == hints_tree( &tree, "ec", 2, &word ) && 0 == word );
+    check( &echoargs == hints_tree( &tree, " echo  o", 8, &word ) && 7 == word );
+    check( &echoargs == hints_tree( &tree, "echo ", 5, &word ) && 5 == word );
+    check( &echoargs == hints_tree( &tree, "echo \"o", 7, &word ) && 6 == word );
+    check( NULL == hints_tree( &tree, "echo on ", 8, &word ) );
+    check( NULL == hints_tree( &tree, "exit ", 5, &word ) );
+    check( NULL == hints_tree( &tree, "ech ", 4, &word ) );
+    check( 1 == hints_find( &hints, "sum", 3 ) && -1 == hints_find( &hints, "su", 2 ) );
+
+    static char const* const inputs [] = {
+        "ec" TAB " o" TAB "\n",
+        "ec" TAB " o" TAB TAB "\n",
+        "echo  of" TAB "\n",
+        "echo \"of" TAB "\"\n",
+        "sum h" TAB "\n",
+        "sum 1 " TAB "\n",
+        "exit o" TAB "\n",
+        /* Only the word under the cursor is replaced. */
+        "echo of extra\033[6D" TAB "\n",
+        "echo o extra\033[6D" TAB TAB "\n",
+        "echo \"of\" x\033[3D" TAB "\n",
+        "sum hx y\033[3D" TAB "\n",
+        "ec sum\033[4D" TAB "\n"
+    };
+    static char const* const expected [] = {
+        "echo off", "echo on", "echo  off", "echo \"off\"", "sum help", "sum 1 ", "exit o",
+        "echo off extra", "echo on extra", "echo \"off\" x", "sum help y", "echo sum"
+    };
+    for( int i = 0; i < sizeof inputs / sizeof *inputs; ++i ) {
+        struct stream stream;
+        memset( &stream, 0, sizeof stream );
+        stream.input = inputs[i];
+        char buff[ 128 ];
+        struct vt100 const vt100 = {
+            .p    = &stream,
+            .line = buff,
+            .max  = sizeof buff,
+            .tree = &tree
+        };
+        vt100_getline( &vt100, echo_on );
+        if( verbose )
+            presult( &stream, buff );
+        check( 0 == strcmp( buff, expected[i] ) );
+    }
+    done();
+}
+
+static int hintHash( void ) {
+    /* The hints set generated by hintgen from words.txt. */
+    struct hints const* const hints = &words;
+    check( 8 == words_qty && words_qty == hints->qty );
+    check( words_login == hints_find( hints, "login", 5 ) );
+    check( words_log_out == hints_find( hints, "log-out", 7 ) );
+    for( int i = 0; i < hints->qty; ++i )
+        check( i == hints_find( hints, hints->str[i], strlen( hints->str[i] ) ) );
+    for( int i = 1; i < hints->qty; ++i )
+        check( 0 > strcmp( hints->str[ hints->index[i-1] ], hints->str[ hints->index[i] ] ) );
+    check( -1 == hints_find( hints, "log_out", 7 ) );
+    check( -1 == hints_find( hints, "sum", 2 ) );
+    check( -1 == hints_find( hints, "summ", 4 ) );
+    check( -1 == hints_find( hints, "", 0 ) );
+    check( 2166136261ul == hints_hashof( "", 0, 0 ) );
+    check( 0xE40C292Cul == hints_hashof( "a", 1, 0 ) );
+    done();
+}
+
+/** Snapshots of shared hints freed. */
+static int freed;
+
+static void freesnap( struct hintsnap* snap ) {
+    ++freed;
+}
+
+static int hintShare( void ) {
+    static char const* const oldwords [] = { "stop", "start" };
+    static char const* const newwords [] = { "status", "stats" };
+    struct hintsnap oldsnap = {
+        .hints = { .str = oldwords, .qty = 2 },
+        .free  = freesnap
+    };
+    struct hintsnap newsnap = {
+        .hints = { .str = newwords, .qty = 2 },
+        .free  = freesnap
+    };
+    struct hintshare share;
+    hintshare_init( &share, &oldsnap );
+    struct stream stream;
+    memset( &stream, 0, sizeof stream );
+    char line[ 128 ];
+    struct vt100 const vt100 = {
+        .p     = &stream,
+        .line  = line,
+        .max   = sizeof line,
+        .share = &share
+    };
+    struct vt100state st;
+    vt100_init( &st, &vt100, echo_on );
+    freed = 0;
+    /* The line started with the old snapshot keeps it when it is replaced. */
+    check( 0 > vt100_feed( &st, "st" TAB, 3, NULL ) );
+    check( 2 == oldsnap.refs );
+    hintshare_publish( &share, &newsnap );
+    check( 1 == oldsnap.refs && 0 == freed );
+    check( 0 > vt100_feed( &st, "a" TAB, 2, NULL ) );
+    check( 0 < vt100_feed( &st, "\n", 1, NULL ) );
+    check( 0 == strcmp( line, "start" ) );
+    check( 1 == freed && 0 == oldsnap.refs );
+    /* The next line gets the new one. */
+    check( 0 > vt100_feed( &st, "st" TAB "u" TAB, 5, NULL ) );
+    check( 2 == newsnap.refs );
+    vt100_newline( &st );
+    check( 1 == newsnap.refs );
+    hintshare_publish( &share, NULL );
+    check( 2 == freed );
+    done();
+}
+
+enum { hintreaders = 3, hintsnaps = 64, acquisitions = 20000 };
+
+/** Snapshot of the shared hints stress test. */
+struct hintlive {
+    struct hintsnap snap;
+    int live; /**< Cleared when the snapshot is freed. */
+};
+
+static void freelive( struct hintsnap* snap ) {
+    __atomic_store_n( &( (struct hintlive*)snap )->live, 0, __ATOMIC_SEQ_CST );
+}
+
+/** Reader of the shared hints stress test. */
+struct hintreader {
+    struct hintshare* share;
+    int* finished; /**< Readers that have finished. */
+    int bad;       /**< Snapshots acquired that were freed or wrong. */
+};
+
+/** Acquire and release the snapshots in the shared hints stress test. */
+static void* hintread( void* p ) {
+    struct hintreader* const reader = p;
+    for( int i = 0; i < acquisitions; ++i ) {
+        struct hintsnap* const snap = hintshare_acquire( reader->share );
+        if( NULL == snap )
+            continue;
+        if( !__atomic_load_n( &( (struct hintlive*)snap )->live, __ATOMIC_SEQ_CST ) )
+            ++reader->bad;
+        else if( -1 == hints_find( &snap->hints, "stats", 5 ) )
+            ++reader->bad;
+        hintshare_release( snap );
+    }
+    __atomic_add_fetch( reader->finished, 1, __ATOMIC_SEQ_CST );
+    return NULL;
+}
+
+static int hintShareThreads( void ) {
+    static char const* const words [] = { "status", "stats" };
+    static struct hintlive snaps[ hintsnaps ];
+    for( int i = 0; i < hintsnaps; ++i ) {
+        snaps[i].snap = (struct hintsnap){
+            .hints = { .str = words, .qty = 2 },
+            .free  = freelive
+        };
+        snaps[i].live = 0;
+    }
+    snaps[0].live = 1;
+    struct hintshare share;
+    hintshare_init( &share, &snaps[0].snap );
+    int finished = 0;
+    struct hintreader readers[ hintreaders ];
+    pthread_t threads[ hintreaders ];
+    for( int i = 0; i < hintreaders; ++i ) {
+        readers[i] = (struct hintreader){ .share = &share, .finished = &finished };
+        check( 0 == pthread_create( &threads[i], NULL, hintread, &readers[i] ) );
+    }
+    /* The replacements race with the acquisitions. Each snapshot is
+       published again once it is freed. */
+    for( int i = 1; hintreaders != __atomic_load_n( &finished, __ATOMIC_SEQ_CST ); ++i ) {
+        struct hintlive* const next = &snaps[ i % hintsnaps ];
+        if( __atomic_load_n( &next->live, __ATOMIC_SEQ_CST ) )
+            continue;
+        __atomic_store_n( &next->live, 1, __ATOMIC_SEQ_CST );
+        hintshare_publish( &share, &next->snap );
+    }
+    for( int i = 0; i < hintreaders; ++i )
+        check( 0 == pthread_join( threads[i], NULL ) );
+    hintshare_publish( &share, NULL );
+    /* No reader had a freed snapshot and each one was freed at the end. */
+    for( int i = 0; i < hintreaders; ++i )
+        check( 0 == readers[i].bad );
+    for( int i = 0; i < hintsnaps; ++i )
+        check( 0 == snaps[i].live && 0 == snaps[i].snap.refs );
+    check( 0 == share.readers );
+    done();
+}
+
+/** Calls to the hints provider and its last prefix. */
+static int provided;
+static char providedprefix[ 16 ];
+
+static char const** provider( void* p, char const* str, int len, int* qty ) {
+    static char const* const words [] = {
+        "session-1", "other", "session-2", "sessions", "status"
+    };
+    static char const* cands[ sizeof words / sizeof *words ];
+    memcpy( cands, words, sizeof words );
+    ++provided;
+    memcpy( providedprefix, str, len );
+    providedprefix[ len ] = '\0';
+    *qty = sizeof words / sizeof *words;
+    return cands;
+}
+
+static int hintProvider( void ) {
+    static char const* const inputs [] = {
+        "se" TAB "-" TAB "\n",
+        "sess" TAB BS BS BS BS BS BS TAB "\n",
+        "x" TAB TAB "\n"
+    };
+    static char const* const prefixes [] = { "se", "s", "x" };
+    static int const calls [] = { 1, 2, 2 };
+    for( int i = 0; i < sizeof inputs / sizeof *inputs; ++i ) {
+        struct stream stream;
+        memset( &stream, 0, sizeof stream );
+        stream.input = inputs[i];
+        char line[ 128 ];
+        struct vt100 const vt100 = {
+            .p        = &stream,
+            .line     = line,
+            .max      = sizeof line,
+            .provider = provider
+        };
+        provided = 0;
+        vt100_getline( &vt100, echo_on );
+        if( verbose )
+            presult( &stream, line );
+        check( calls[i] == provided );
+        check( 0 == strcmp( providedprefix, prefixes[i] ) );
+        if( 0 == i )
+            check( 0 == strcmp( line, "session-1" ) || 0 == strcmp( line, "session-2" ) );
+        if( 2 == i )
+            check( 0 == strcmp( line, "x" ) );
+    }
+    /* The fuzzy search gets all the candidates and scores them. */
+    static char const* const fuzzyinputs [] = { "s2" TAB "\n", "tu" TAB "\n", "s" TAB TAB "\n" };
+    static char const* const fuzzylines [] = { "session-2", "status", "sessions" };
+    static int const fuzzycalls [] = { 1, 1, 1 };
+    for( int i = 0; i < sizeof fuzzyinputs / sizeof *fuzzyinputs; ++i ) {
+        struct stream stream;
+        memset( &stream, 0, sizeof stream );
+        stream.input = fuzzyinputs[i];
+        char line[ 128 ];
+        struct vt100 const vt100 = {
+            .p        = &stream,
+            .line     = line,
+            .max      = sizeof line,
+            .provider = provider,
+            .fuzzy    = 1
+        };
+        provided = 0;
+        vt100_getline( &vt100, echo_on );
+        if( verbose )
+            presult( &stream, line );
+        check( fuzzycalls[i] == provided );
+        check( 0 == strcmp( providedprefix, "" ) );
+        check( 0 == strcmp( line, fuzzylines[i] ) );
+    }
+    done();
+}
+
+static int listing( void ) {
+    enum { qty = 1000 };
+    static char words[ qty ][ 8 ];
+    static char const* strs[ qty ];
+    for( int i = 0; i < qty; ++i ) {
+        sprintf( words[i], "cmd%03d", i );
+        strs[i] = words[i];
+    }
+    int index[ qty ];
+    struct hints hints = {
+        .str = strs,
+        .qty = qty
+    };
+    for( int indexed = 0; indexed < 2; ++indexed ) {
+        if( indexed ) {
+            hints_index( &hints, index );
+            hints.index = index;
+        }
+        struct stream stream;
+        memset( &stream, 0, sizeof stream );
+        stream.input = "c" TAB TAB " q1\n";
+        char line[ 128 ];
+        struct vt100 const vt100 = {
+            .p      = &stream,
+            .line   = line,
+            .max    = sizeof line,
+            .hints  = &hints,
+            .cols   = 40,
+            .rows   = 4,
+            .prompt = "> "
+        };
+        int const len = vt100_getline( &vt100, echo_on );
+        if( verbose )
+            presult( &stream, line );
+        check( 0 == strcmp( line, "cmd1" ) && 4 == len );
+        /* Five columns of eight, three lines a page, two pages. */
+        check( NULL != strstr( stream.output, "\r\ncmd000  cmd001  cmd002  cmd003  cmd004\r\n" ) );
+        check( NULL != strstr( stream.output, "cmd029\r\n\033[7m--More-- 970\033[0m" ) );
+        check( NULL == strstr( stream.output, "cmd030" ) );
+        check( NULL != strstr( stream.output, "\r\033[K> cmd" ) );
+    }
+    /* Other keys end the listing and then they are processed, like a paste. */
+    {
+        struct stream stream;
+        memset( &stream, 0, sizeof stream );
+        stream.input = "c" TAB TAB "\033[200~1\n2\033[201~9\n";
+        char line[ 128 ];
+        struct vt100 const vt100 = {
+            .p      = &stream,
+            .line   = line,
+            .max    = sizeof line,
+            .hints  = &hints,
+            .rows   = 4,
+            .prompt = "> "
+        };
+        int const len = vt100_getline( &vt100, echo_on );
+        if( verbose )
+            presult( &stream, line );
+        check( 0 == strcmp( line, "cmd1 29" ) && 7 == len );
+        check( NULL != strstr( stream.output, "--More--" ) );
+    }
+    /* A listing that fits in a page ends without the pager. */
+    hints.qty = 3;
+    hints.index = NULL;
+    struct stream stream;
+    memset( &stream, 0, sizeof stream );
+    stream.input = "c" TAB TAB "\n";
+    char line[ 128 ];
+    struct vt100 const vt100 = {
+        .p      = &stream,
+        .line   = line,
+        .max    = sizeof line,
+        .hints  = &hints,
+        .rows   = 4,
+        .prompt = "> "
+    };
+    vt100_getline( &vt100, echo_on );
+    if( verbose )
+        presult( &stream, line );
+    check( 0 == strcmp( line, "cmd00" ) );
+    check( NULL != strstr( stream.output, "cmd00\r\ncmd000  cmd001  cmd002\r\n> cmd00" ) );
+    done();
+}
+
+static int redraw( void ) {
+    static char const* const inputs[] = {
+        "show interface eth0 status\n",
+        "show interface eth1 status\n",
+    };
+    enum { nunlines = 4, linelen = 32 };
+    char histmem[nunlines][linelen];
+    struct historycfg const histcfg = {
+        .lines    = histmem,
+        .linelen  = linelen,
+        .numlines = nunlines,
+    };
+    struct history hist;
+    history_init( &hist, &histcfg );
+    struct stream stream;
+    char line[ 128 ];
+    struct vt100 const vt100 = {
+        .p     = &stream,
+        .line  = line,
+        .max   = sizeof line,
+        .hist  = &hist,
+        .hints = NULL,
+    };
+    for( int i = 0; i < 2; ++i ) {
+        memset( &stream, 0, sizeof stream );
+        stream.input = inputs[i];
+        vt100_getline( &vt100, echo_on );
+    }
+    struct vt100state st;
+    memset( &stream, 0, sizeof stream );
+    vt100_init( &st, &vt100, echo_on );
+    static char const recall[] = "show " ARROW_UP;
+    vt100_feed( &st, recall, sizeof recall - 1, NULL );
+    int iout = stream.iout;
+    vt100_feed( &st, ARROW_UP, sizeof ARROW_UP - 1, NULL );
+    check( 16 > stream.iout - iout );
+    static char const edit[] = "\033[10CX\010\033[5C" DEL "Y" BS;
+    for( int i = 0; i < sizeof edit - 1; ++i )
+        vt100_char( &st, edit[i] );
+    char screen[ 128 ];
+    int const col = emulate( stream.output, screen, sizeof screen );
+    if( verbose ) {
+        printf( "\n%s", " -Output: " );
+        printstr( stream.output );
+        printf( "\n%s%s\n", " -Screen: ", screen );
+    }
+    check( 0 == strcmp( screen, "show interface statu" ) );
+    check( st.cur == col );
+    check( 0 == memcmp( line, screen, st.len ) );
+    done();
+}
+
+static int gapBuffer( void ) {
+    static char const input[] = "configure terminal width 80" HOME "x" BS
+                                "\033[10C" DEL "T" END "\033[2D" BS "9"
+                                HOME "\033OC\033OC\010\n";
+    static char const expected[] = "configure width980";
+    struct stream stream;
+    memset( &stream, 0, sizeof stream );
+    stream.input = input;
+    char line[ 64 ];
+    struct vt100 const vt100 = {
+        .p     = &stream,
+        .line  = line,
+        .max   = sizeof line,
+        .hist  = NULL,
+        .hints = NULL
+    };
+    int const len = vt100_getline( &vt100, echo_on );
+    if( verbose )
+        presult( &stream, line );
+    check( len == sizeof expected - 1 );
+    check( 0 == strcmp( line, expected ) );
+    char screen[ 64 ];
+    stream.output[ stream.iout - 2 ] = '\0';
+    emulate( stream.output, screen, sizeof screen );
+    check( 0 == strcmp( screen, expected ) );
+    done();
+}
+
+static int growable( void ) {
+    enum { size = 1 << 20 };
+    char* const input = malloc( size );
+    for( int i = 0; i < size; ++i )
+        input[i] = 'a' + i % 26;
+    struct stream stream;
+    memset( &stream, 0, sizeof stream );
+    struct vt100 const vt100 = {
+        .p     = &stream,
+        .line  = malloc( 16 ),
+        .max   = 16,
+        .grow  = realloc
+    };
+    struct vt100state st;
+    vt100_init( &st, &vt100, echo_off );
+    vt100_feed( &st, input, size / 2, NULL );
+    vt100_feed( &st, HOME "\033[200~", sizeof HOME "\033[200~" - 1, NULL );
+    vt100_feed( &st, input + size / 2, size / 2, NULL );
+    int const len = vt100_feed( &st, "\033[201~\n", sizeof "\033[201~\n" - 1, NULL );
+    check( size == len );
+    check( size < st.max );
+    check( 0 == memcmp( st.line, input + size / 2, size / 2 ) );
+    check( 0 == memcmp( st.line + size / 2, input, size / 2 ) );
+    check( '\0' == st.line[ size ] );
+    free( st.line );
+    free( input );
+    done();
+}
+
+static int viewport( void ) {
+    static char const input[] = "interface ethernet0 description uplink"
+                                HOME "\033OC\033OC" DEL "E" END BS "\033[8D\010"
+                                "\033[200~ to core\033[201~" HOME "\033[25C";
+    static char const expected[] = "interface ethernet0  to coreuplin";
+    enum { cols = 12 };
+    struct stream stream;
+    memset( &stream, 0, sizeof stream );
+    char line[ 64 ];
+    struct vt100 const vt100 = {
+        .p     = &stream,
+        .line  = line,
+        .max   = sizeof line,
+        .cols  = cols
+    };
+    struct vt100state st;
+    vt100_init( &st, &vt100, echo_on );
+    char screen[ 128 ];
+    int col;
+    for( int i = 0; i < sizeof input - 1; ++i ) {
+        int const iout = stream.iout;
+        vt100_char( &st, input[i] );
+        check( 2 * cols + 16 > stream.iout - iout );
+        col = emulate( stream.output, screen, sizeof screen );
+        check( strlen( screen ) < cols );
+        check( col == st.col );
+    }
+    check( col == st.cur - st.off );
+    check( 0 == memcmp( screen, expected + st.off, strlen( screen ) ) );
+    vt100_char( &st, '\n' );
+    check( 0 == strcmp( line, expected ) );
+    done();
+}
+
+static int paste( void ) {
+    static char const input[] = "One Three\033[6D\033[200~ T\177wo\033[A\033[201~\n";
+    static char const expected[] = "One Two Three";
+    char line[ 128 ];
+    int const len = processline( input, line, sizeof line, NULL );
+    check( len == sizeof expected - 1 );
+    check( 0 == strcmp( line, expected ) );
+    /* The mode is enabled once for a session and disabled at its end. */
+    struct stream stream;
+    memset( &stream, 0, sizeof stream );
+    stream.input = "one\ntwo\n";
+    struct vt100 const vt100 = {
+        .p    = &stream,
+        .line = line,
+        .max  = sizeof line
+    };
+    vt100_start( &vt100 );
+    check( 0 == strcmp( "\033[?2004h", stream.output ) );
+    vt100_getline( &vt100, echo_on );
+    vt100_getline( &vt100, echo_on );
+    check( NULL == strstr( stream.output + 1, "\033[?2004" ) );
+    vt100_stop( &vt100 );
+    check( 0 == strcmp( "\033[?2004l", stream.output + strlen( stream.output ) - 8 ) );
+    done();
+}
+
+static int coalescing( void ) {
+    static char const input[] = "abcdef\033[4Dxyz\n";
+    static char const expected[] = "abxyzcdef";
+    struct stream stream;
+    memset( &stream, 0, sizeof stream );
+    stream.input = input;
+    char line[ 128 ];
+    struct vt100 const vt100 = {
+        .p     = &stream,
+        .line  = line,
+        .max   = sizeof line,
+        .hist  = NULL,
+        .hints = NULL
+    };
+    int const len = vt100_getline( &vt100, echo_on );
+    if( verbose )
+        presult( &stream, line );
+    check( len == sizeof expected - 1 );
+    check( 0 == strcmp( line, expected ) );
+    check( 6 + 1 + 3 + 1 == stream.writes );
+    done();
+}
+
+static int feed( void ) {
+    static char const input[] = "One Two\033[DX\033[C Three\r\nFour\n";
+    struct stream stream;
+    memset( &stream, 0, sizeof stream );
+    char line[ 128 ];
+    struct vt100 const vt100 = {
+        .p     = &stream,
+        .line  = line,
+        .max   = sizeof line,
+        .hist  = NULL,
+        .hints = NULL
+    };
+    struct vt100state st;
+    vt100_init( &st, &vt100, echo_on );
+    int used;
+    int len = vt100_feed( &st, input, sizeof input - 1, &used );
+    check( len == sizeof "One TwXo Three" - 1 );
+    check( 0 == strcmp( line, "One TwXo Three" ) );
+    check( input[used-1] == '\r' );
+    int const first = used;
+    len = vt100_feed( &st, input + first, sizeof input - 1 - first, &used );
+    check( 0 == len );
+    check( 1 == used );
+    int const second = first + used;
+    len = vt100_feed( &st, input + second, sizeof input - 1 - second, &used );
+    check( len == sizeof "Four" - 1 );
+    check( 0 == strcmp( line, "Four" ) );
+    check( second + used == sizeof input - 1 );
+    len = vt100_feed( &st, "Fi", 2, &used );
+    check( 0 > len && 2 == used );
+    done();
+}
+
+static int utf8( void ) {
+    static char const input[] = "na\xC3\xAFve\033[3D" DEL "i" END " \xE4\xB8\xAD" BS
+                                "e\xCC\x81\033[Dx" END "\xC3(\xFF\xE2\x82" "A\xC2\x85\n";
+    static char const expected[] = "naive xe\xCC\x81(A";
+    char line[ 128 ];
+    int len = processline( input, line, sizeof line, NULL );
+    check( len == sizeof expected - 1 );
+    check( 0 == strcmp( line, expected ) );
+
+    /* A sequence split between two receive buffers. */
+    struct stream stream;
+    memset( &stream, 0, sizeof stream );
+    struct vt100 vt100 = {
+        .p     = &stream,
+        .line  = line,
+        .max   = sizeof line
+    };
+    struct vt100state st;
+    vt100_init( &st, &vt100, echo_on );
+    static char const chunk1[] = "h\xC3\xA9llo \xE4\xB8";
+    static char const chunk2[] = "\xAD\xE6\x96\x87\n";
+    check( 0 > vt100_feed( &st, chunk1, sizeof chunk1 - 1, NULL ) );
+    len = vt100_feed( &st, chunk2, sizeof chunk2 - 1, NULL );
+    check( len == sizeof "h\xC3\xA9llo \xE4\xB8\xAD\xE6\x96\x87" - 1 );
+    check( 0 == strcmp( line, "h\xC3\xA9llo \xE4\xB8\xAD\xE6\x96\x87" ) );
+
+    /* Wide characters in a horizontal scroll. */
+    static char const wide[] = "\xE4\xB8\xAD\xE6\x96\x87 ab \xE4\xB8\xAD\xE6\x96\x87\xE5\xAD\x97"
+                               "c\xCC\x81 \xC3\xB1" HOME "\033[3C\xE5\xAD\x97" DEL "\033[4C"
+                               BS "\xC3\xA9" END BS "\033[3D" "\xE2\x80\x94";
+    static char const expectedwide[] = "\xE4\xB8\xAD\xE6\x96\x87 \xE5\xAD\x97" "b \xE4\xB8\xAD"
+                                       "\xC3\xA9\xE2\x80\x94\xE5\xAD\x97" "c\xCC\x81 ";
+    enum { cols = 8 };
+    memset( &stream, 0, sizeof stream );
+    vt100.cols = cols;
+    vt100_init( &st, &vt100, echo_on );
+    char screen[ 128 ];
+    int col = 0;
+    for( int i = 0; i < sizeof wide - 1; ++i ) {
+        vt100_char( &st, (unsigned char)wide[i] );
+        col = emulate( stream.output, screen, sizeof screen );
+        check( col == st.col );
+        check( col < cols );
+    }
+    for( char const* key = END; '\0' != *key; ++key )
+        vt100_char( &st, *key );
+    emulate( stream.output, screen, sizeof screen );
+    check( 0 == memcmp( screen, st.line + st.off, strlen( screen ) ) );
+    vt100_char( &st, '\n' );
+    check( 0 == strcmp( line, expectedwide ) );
+    done();
+}
+
 static int history( void ) {
     enum {
         nunlines = 8,
@@ -351,6 +1274,864 @@ static int history( void ) {
     done();
 }
 
+static int historyIndex( void ) {
+    enum { numlines = 64, linelen = 24, size = 384, buckets = 16 };
+    static char const* const words[] = {
+        "a", "ab", "abc", "abd", "b", "ba", "interface eth0", "interface eth1",
+        "interface eth0 up", "interface eth1 down", "show", "show status"
+    };
+    enum { qty = sizeof words / sizeof *words };
+    char plainmem[ size ];
+    char indexmem[ size ];
+    struct historylinks links[ numlines ];
+    long heads[ HISTORY_LEVELS * buckets ];
+    struct historycfg const plaincfg = {
+        .lines    = plainmem,
+        .linelen  = linelen,
+        .size     = size
+    };
+    struct historycfg const indexcfg = {
+        .lines    = indexmem,
+        .linelen  = linelen,
+        .numlines = numlines,
+        .size     = size,
+        .links    = links,
+        .heads    = heads,
+        .buckets  = buckets
+    };
+    struct history plain;
+    struct history indexed;
+    history_init( &plain, &plaincfg );
+    history_init( &indexed, &indexcfg );
+    srand( 1 );
+    /* The index gives the same results as the search one by one. */
+    for( int i = 0; i < 20000; ++i ) {
+        char const* const word = words[ rand() % qty ];
+        int const len = rand() % ( strlen( word ) + 1 );
+        char const* a = NULL;
+        char const* b = NULL;
+        switch( rand() % 8 ) {
+            case 0:
+            case 1:
+                history_line( &plain, word );
+                history_line( &indexed, word );
+                continue;
+            case 2:
+                plain.pos = indexed.pos = -1;
+                continue;
+            case 3:
+            case 4:
+            case 5:
+                a = history_backward( &plain, word, len );
+                b = history_backward( &indexed, word, len );
+                break;
+            default:
+                a = history_forward( &plain, word, len );
+                b = history_forward( &indexed, word, len );
+                break;
+        }
+        check( plain.pos == indexed.pos );
+        check( ( NULL == a ) == ( NULL == b ) );
+        check( NULL == a || 0 == strcmp( a, b ) );
+    }
+    /* Entries longer than the line length are cut. */
+    history_line( &indexed, "a line longer than the entries" );
+    check( linelen - 1 == strlen( history_backward( &indexed, "a line", 6 ) ) );
+    done();
+}
+
+static int historyArena( void ) {
+    enum { linelen = 32, size = 64, numlines = 4, buckets = 4 };
+    char mem[ size ];
+    struct historycfg const cfg = {
+        .lines   = mem,
+        .linelen = linelen,
+        .size    = size
+    };
+    struct history hist;
+    history_init( &hist, &cfg );
+    check( NULL == history_oldest( &hist ) );
+    /* Short entries are packed: ten fit where two lines did. */
+    static char const* const digits[] = { "0", "1", "2", "3", "4", "5", "6", "7", "8", "9" };
+    for( int i = 0; i < 10; ++i )
+        history_line( &hist, digits[i] );
+    int i = 0;
+    for( char const* e = history_oldest( &hist ); NULL != e; e = history_newer( &hist, e ) )
+        check( i < 10 && 0 == strcmp( e, digits[i++] ) );
+    check( 10 == i );
+    /* The oldest entries are evicted and the walks both ways agree. */
+    char added[ 1000 ][ linelen ];
+    srand( 2 );
+    history_erase( &hist );
+    for( int n = 0; n < 1000; ++n ) {
+        int const len = rand() % ( linelen - 1 );
+        for( int j = 0; j < len; ++j )
+            added[n][j] = 'a' + rand() % 26;
+        added[n][len] = '\0';
+        history_line( &hist, added[n] );
+        int bytes = 0;
+        int k = n + 1 - hist.count;
+        for( char const* e = history_oldest( &hist ); NULL != e; e = history_newer( &hist, e ) ) {
+            check( 0 == strcmp( e, added[k++] ) );
+            bytes += strlen( e ) + 5;
+        }
+        check( n + 1 == k && size >= bytes );
+        for( char const* e = history_backward( &hist, "", 0 ); NULL != e; e = history_backward( &hist, "", 0 ) ) {
+            check( 0 == strcmp( e, added[--k] ) );
+            if( hist.pos == hist.oldest )
+                break;
+        }
+        check( n + 1 - hist.count == k );
+        hist.pos = -1;
+    }
+    /* With the index, numlines caps the number of entries. */
+    struct historylinks links[ numlines ];
+    long heads[ HISTORY_LEVELS * buckets ];
+    char big[ 1024 ];
+    struct historycfg const indexcfg = {
+        .lines    = big,
+        .linelen  = linelen,
+        .numlines = numlines,
+        .size     = sizeof big,
+        .links    = links,
+        .heads    = heads,
+        .buckets  = buckets
+    };
+    history_init( &hist, &indexcfg );
+    for( int j = 0; j < 10; ++j )
+        history_line( &hist, digits[j] );
+    check( numlines == hist.count );
+    check( 0 == strcmp( digits[6], history_oldest( &hist ) ) );
+    check( 0 == strcmp( digits[7], history_backward( &hist, "7", 1 ) ) );
+    done();
+}
+
+static int historyDedup( void ) {
+    enum { linelen = 24, size = 256, numlines = 32, slots = 64, buckets = 16 };
+    static char const* const words[] = {
+        "a", "ab", "abc", "show", "show status", "interface eth0", "interface eth1", ""
+    };
+    enum { qty = sizeof words / sizeof *words };
+    char plainmem[ size ];
+    char indexmem[ size ];
+    int plaindups[ slots ];
+    int indexdups[ slots ];
+    struct historylinks links[ numlines ];
+    long heads[ HISTORY_LEVELS * buckets ];
+    struct historycfg const plaincfg = {
+        .lines    = plainmem,
+        .linelen  = linelen,
+        .size     = size,
+        .dups     = plaindups,
+        .dupslots = slots
+    };
+    struct historycfg const indexcfg = {
+        .lines    = indexmem,
+        .linelen  = linelen,
+        .numlines = numlines,
+        .size     = size,
+        .links    = links,
+        .heads    = heads,
+        .buckets  = buckets,
+        .dups     = indexdups,
+        .dupslots = slots
+    };
+    struct history plain;
+    struct history indexed;
+    history_init( &plain, &plaincfg );
+    history_init( &indexed, &indexcfg );
+    /* A repeated line is stored once. */
+    for( int i = 0; i < 30; ++i )
+        history_line( &plain, "show status" );
+    check( 1 == plain.count );
+    /* The repeated lines do not evict the other ones. */
+    struct historycfg const smallcfg = {
+        .lines    = plainmem,
+        .linelen  = linelen,
+        .size     = 128,
+        .dups     = plaindups,
+        .dupslots = slots
+    };
+    struct historycfg const fewcfg = {
+        .lines    = indexmem,
+        .linelen  = linelen,
+        .numlines = 8,
+        .size     = size,
+        .links    = links,
+        .heads    = heads,
+        .buckets  = buckets,
+        .dups     = indexdups,
+        .dupslots = slots
+    };
+    static char const* const kept[] = { "unique-one", "unique-two", "show status", "ls" };
+    history_init( &plain, &smallcfg );
+    history_init( &indexed, &fewcfg );
+    for( int i = 0; i < 62; ++i ) {
+        history_line( &plain, kept[ i < 2 ? i : 2 + i % 2 ] );
+        history_line( &indexed, kept[ i < 2 ? i : 2 + i % 2 ] );
+    }
+    int n = 0;
+    for( char const* e = history_oldest( &plain ); NULL != e; e = history_newer( &plain, e ) )
+        check( n < 4 && 0 == strcmp( e, kept[ n++ ] ) );
+    check( 4 == n );
+    n = 0;
+    for( char const* e = history_oldest( &indexed ); NULL != e; e = history_newer( &indexed, e ) )
+        check( n < 4 && 0 == strcmp( e, kept[ n++ ] ) );
+    check( 4 == n );
+    char const* e = history_backward( &indexed, "uni", 3 );
+    check( NULL != e && 0 == strcmp( e, kept[1] ) );
+    e = history_backward( &indexed, "uni", 3 );
+    check( NULL != e && 0 == strcmp( e, kept[0] ) );
+    history_init( &plain, &plaincfg );
+    history_init( &indexed, &indexcfg );
+    /* The live entries are the lines without repetitions. */
+    char const* order[ qty ];
+    int num = 0;
+    srand( 3 );
+    for( int i = 0; i < 20000; ++i ) {
+        char const* const word = words[ rand() % qty ];
+        int const len = rand() % ( strlen( word ) + 1 );
+        char const* a = NULL;
+        char const* b = NULL;
+        switch( rand() % 8 ) {
+            case 0:
+            case 1: {
+                history_line( &plain, word );
+                history_line( &indexed, word );
+                int j = 0;
+                while( j < num && order[j] != word )
+                    ++j;
+                for( ; j < num - 1; ++j )
+                    order[j] = order[j+1];
+                order[ j < num ? j : num++ ] = word;
+                int k = num;
+                char const* e = history_oldest( &plain );
+                for( char const* w = e; NULL != w; w = history_newer( &plain, w ) )
+                    --k;
+                check( 0 == k );
+                for( ; NULL != e; e = history_newer( &plain, e ) )
+                    check( 0 == strcmp( e, order[k++] ) );
+                continue;
+            }
+            case 2:
+                plain.pos = indexed.pos = -1;
+                continue;
+            case 3:
+            case 4:
+            case 5:
+                a = history_backward( &plain, word, len );
+                b = history_backward( &indexed, word, len );
+                break;
+            default:
+                a = history_forward( &plain, word, len );
+                b = history_forward( &indexed, word, len );
+                break;
+        }
+        check( plain.pos == indexed.pos );
+        check( ( NULL == a ) == ( NULL == b ) );
+        check( NULL == a || 0 == strcmp( a, b ) );
+    }
+    done();
+}
+
+/** Get the size of a file.
+  * @param path Path of the file.
+  * @return The size in bytes or -1 if it can not be opened. */
+static long filesize( char const* path ) {
+    FILE* const file = fopen( path, "rb" );
+    if( NULL == file )
+        return -1;
+    fseek( file, 0, SEEK_END );
+    long const size = ftell( file );
+    fclose( file );
+    return size;
+}
+
+static int historyLog( void ) {
+    enum { linelen = 16, size = 128 };
+    static char const path[] = "histlog-test.log";
+    char mem[ size ];
+    char batch[ 64 ];
+    struct histlog log;
+    struct historycfg const histcfg = {
+        .lines   = mem,
+        .linelen = linelen,
+        .size    = size,
+        .store   = histlog_store,
+        .p       = &log
+    };
+    struct histlogcfg const logcfg = {
+        .path      = path,
+        .batch     = batch,
+        .batchsize = sizeof batch
+    };
+    static char const* const lines[] = { "one", "two", "three", "four", "five" };
+    enum { qty = sizeof lines / sizeof *lines };
+    struct history hist;
+    remove( path );
+    history_init( &hist, &histcfg );
+    check( 0 == histlog_open( &log, &logcfg, &hist ) );
+    for( int i = 0; i < qty; ++i )
+        history_line( &hist, lines[i] );
+    check( 0 == histlog_close( &log ) );
+    /* The lines are loaded again. */
+    history_init( &hist, &histcfg );
+    check( 0 == histlog_open( &log, &logcfg, &hist ) );
+    int i = 0;
+    for( char const* e = history_oldest( &hist ); NULL != e; e = history_newer( &hist, e ) )
+        check( i < qty && 0 == strcmp( e, lines[i++] ) );
+    check( qty == i );
+    check( 0 == histlog_close( &log ) );
+    /* A torn record at the end is discarded. */
+    FILE* const file = fopen( path, "ab" );
+    check( NULL != file );
+    fwrite( "\x09\x00\x12\x34\x56\x78torn", 1, 10, file );
+    fclose( file );
+    history_init( &hist, &histcfg );
+    check( 0 == histlog_open( &log, &logcfg, &hist ) );
+    check( qty == hist.count );
+    history_line( &hist, "six" );
+    check( 0 == histlog_close( &log ) );
+    history_init( &hist, &histcfg );
+    check( 0 == histlog_open( &log, &logcfg, &hist ) );
+    check( qty + 1 == hist.count );
+    check( 0 == strcmp( "six", history_backward( &hist, "", 0 ) ) );
+    check( 0 == histlog_close( &log ) );
+    /* The log is compacted to the entries of the history by the writer. */
+    char snap[ 2 * size ];
+    struct histlogcfg const smallcfg = {
+        .path      = path,
+        .max       = 2 * size,
+        .batch     = batch,
+        .batchsize = sizeof batch,
+        .snap      = snap,
+        .snapsize  = sizeof snap
+    };
+    history_init( &hist, &histcfg );
+    check( 0 == histlog_open( &log, &smallcfg, &hist ) );
+    char line[ linelen ];
+    for( int j = 0; j < 500; ++j ) {
+        sprintf( line, "line %d", j );
+        history_line( &hist, line );
+        if( 9 == j % 10 )
+            check( 0 == histlog_flush( &log ) );
+    }
+    check( 0 == histlog_close( &log ) );
+    check( 3 * size > filesize( path ) );
+    /* It is not compacted while the lines are stored, only when flushed. */
+    history_init( &hist, &histcfg );
+    check( 0 == histlog_open( &log, &smallcfg, &hist ) );
+    for( int j = 500; j < 540; ++j ) {
+        sprintf( line, "line %d", j );
+        history_line( &hist, line );
+    }
+    check( 0 == histlog_close( &log ) );
+    check( 2 * size < filesize( path ) );
+    history_init( &hist, &histcfg );
+    check( 0 == histlog_open( &log, &smallcfg, &hist ) );
+    check( 0 == histlog_flush( &log ) );
+    check( 0 == histlog_close( &log ) );
+    check( 2 * size >= filesize( path ) && -1 == filesize( "histlog-test.log.tmp" ) );
+    int const count = hist.count;
+    history_init( &hist, &histcfg );
+    check( 0 == histlog_open( &log, &logcfg, &hist ) );
+    check( count == hist.count );
+    check( 0 == strcmp( "line 539", history_backward( &hist, "", 0 ) ) );
+    check( 0 == histlog_close( &log ) );
+    remove( path );
+    done();
+}
+
+static int historyFrontCoding( void ) {
+    enum { linelen = 48, size = 1024, restart = 8 };
+    static char const* const words[] = {
+        "interface eth0", "interface eth0 up", "interface eth1 down",
+        "set config", "set config timeout 30", "show", "show status", "a", ""
+    };
+    enum { qty = sizeof words / sizeof *words };
+    /* It holds more entries than storing them in full. */
+    static char plainmem[ size ];
+    static char codedmem[ size ];
+    struct historycfg const plaincfg = {
+        .lines   = plainmem,
+        .linelen = linelen,
+        .size    = size
+    };
+    struct historycfg const codedcfg = {
+        .lines   = codedmem,
+        .linelen = linelen,
+        .size    = size,
+        .restart = restart
+    };
+    struct history plain;
+    struct history coded;
+    history_init( &plain, &plaincfg );
+    history_init( &coded, &codedcfg );
+    char line[ linelen ];
+    for( int i = 0; i < 1000; ++i ) {
+        check( sizeof line > snprintf( line, sizeof line, "interface eth%d description uplink %d", i / 10, i ) );
+        history_line( &plain, line );
+        history_line( &coded, line );
+    }
+    check( 2 * plain.count <= coded.count );
+    int n = 1000 - coded.count;
+    for( char const* e = history_oldest( &coded ); NULL != e; e = history_newer( &coded, e ) ) {
+        check( sizeof line > snprintf( line, sizeof line, "interface eth%d description uplink %d", n / 10, n ) );
+        check( 0 == strcmp( e, line ) );
+        ++n;
+    }
+    check( 1000 == n );
+    /* The entries evicted are the oldest and the duplicates are dropped,
+       without evicting the other entries while there is room for them. */
+    enum { slots = 256 };
+    int dups[ slots ];
+    struct historycfg const dupcfg = {
+        .lines    = codedmem,
+        .linelen  = linelen,
+        .size     = 256,
+        .restart  = restart,
+        .dups     = dups,
+        .dupslots = slots
+    };
+    history_init( &coded, &dupcfg );
+    static char const* const shows[] = {
+        "show", "show status", "show version", "show config", "show"
+    };
+    for( int i = 0; i < sizeof shows / sizeof *shows; ++i )
+        history_line( &coded, shows[i] );
+    n = 1;
+    for( char const* e = history_oldest( &coded ); NULL != e; e = history_newer( &coded, e ) )
+        check( 0 == strcmp( e, shows[ n++ ] ) );
+    check( sizeof shows / sizeof *shows == n );
+    int widedups[ slots ];
+    struct historycfg const widecfg = {
+        .lines    = plainmem,
+        .linelen  = linelen,
+        .size     = size,
+        .restart  = restart,
+        .dups     = widedups,
+        .dupslots = slots
+    };
+    struct history wide;
+    history_init( &coded, &dupcfg );
+    history_init( &wide, &widecfg );
+    char const* order[ qty ];
+    int num = 0;
+    srand( 4 );
+    for( int i = 0; i < 5000; ++i ) {
+        char const* const word = words[ rand() % qty ];
+        history_line( &coded, word );
+        history_line( &wide, word );
+        int j = 0;
+        while( j < num && order[j] != word )
+            ++j;
+        for( ; j < num - 1; ++j )
+            order[j] = order[j+1];
+        order[ j < num ? j : num++ ] = word;
+        int k = num;
+        for( char const* e = history_oldest( &coded ); NULL != e; e = history_newer( &coded, e ) )
+            --k;
+        check( 0 <= k && k < num );
+        int const first = k;
+        for( char const* e = history_oldest( &coded ); NULL != e; e = history_newer( &coded, e ) )
+            check( 0 == strcmp( e, order[k++] ) );
+        for( char const* e = history_backward( &coded, "", 0 ); NULL != e; e = history_backward( &coded, "", 0 ) ) {
+            check( 0 == strcmp( e, order[--k] ) );
+            if( coded.pos == coded.oldest )
+                break;
+        }
+        check( first == k );
+        coded.pos = -1;
+        k = 0;
+        for( char const* e = history_oldest( &wide ); NULL != e && k < num; e = history_newer( &wide, e ) )
+            check( 0 == strcmp( e, order[k++] ) );
+        check( num == k && num == wide.count - wide.dead );
+    }
+    /* The searches give the same results as without front coding. */
+    enum { numlines = 1024, buckets = 256 };
+    static struct historylinks plainlinks[ numlines ];
+    static struct historylinks codedlinks[ numlines ];
+    static long plainheads[ HISTORY_LEVELS * buckets ];
+    static long codedheads[ HISTORY_LEVELS * buckets ];
+    static char plainbig[ 16384 ];
+    static char codedbig[ 16384 ];
+    struct historycfg const plainidx = {
+        .lines    = plainbig,
+        .linelen  = linelen,
+        .numlines = numlines,
+        .size     = sizeof plainbig,
+        .links    = plainlinks,
+        .heads    = plainheads,
+        .buckets  = buckets
+    };
+    struct historycfg const codedidx = {
+        .lines    = codedbig,
+        .linelen  = linelen,
+        .numlines = numlines,
+        .size     = sizeof codedbig,
+        .links    = codedlinks,
+        .heads    = codedheads,
+        .buckets  = buckets,
+        .restart  = restart
+    };
+    history_init( &plain, &plainidx );
+    history_init( &coded, &codedidx );
+    for( int i = 0; i < 2000; ++i ) {
+        char const* const word = words[ rand() % qty ];
+        int const len = rand() % ( strlen( word ) + 1 );
+        char const* a = NULL;
+        char const* b = NULL;
+        int ata = -1;
+        int atb = -1;
+        switch( rand() % 8 ) {
+            case 0:
+                history_line( &plain, word );
+                history_line( &coded, word );
+                continue;
+            case 1:
+                plain.pos = coded.pos = -1;
+                continue;
+            case 2: {
+                int const older = rand() % 2;
+                a = history_search( &plain, word + len / 2, len - len / 2, older, &ata );
+                b = history_search( &coded, word + len / 2, len - len / 2, older, &atb );
+                break;
+            }
+            case 3:
+            case 4:
+                a = history_backward( &plain, word, len );
+                b = history_backward( &coded, word, len );
+                break;
+            default:
+                a = history_forward( &plain, word, len );
+                b = history_forward( &coded, word, len );
+                break;
+        }
+        check( ( NULL == a ) == ( NULL == b ) );
+        check( NULL == a || 0 == strcmp( a, b ) );
+        check( ata == atb );
+    }
+    done();
+}
+
+static int historyShare( void ) {
+    enum { numslots = 4, linelen = 16, size = 256 };
+    struct histslot slots[ numslots ];
+    char lines[ numslots ][ linelen ];
+    struct histsharecfg const sharecfg = {
+        .slots    = slots,
+        .lines    = *lines,
+        .numslots = numslots,
+        .linelen  = linelen
+    };
+    struct histshare share;
+    histshare_init( &share, &sharecfg );
+    char mema[ size ];
+    char memb[ size ];
+    struct histsession a;
+    struct histsession b;
+    struct historycfg const cfga = {
+        .lines   = mema,
+        .linelen = linelen,
+        .size    = size,
+        .store   = histshare_store,
+        .p       = &a
+    };
+    struct historycfg const cfgb = {
+        .lines   = memb,
+        .linelen = linelen,
+        .size    = size,
+        .store   = histshare_store,
+        .p       = &b
+    };
+    struct history hista;
+    struct history histb;
+    history_init( &hista, &cfga );
+    history_init( &histb, &cfgb );
+    histshare_session( &a, &share, &hista );
+    histshare_session( &b, &share, &histb );
+    /* Each session gets the lines of the other one, but not its own. */
+    history_line( &hista, "one" );
+    history_line( &histb, "two" );
+    history_line( &hista, "three" );
+    check( 1 == histshare_pull( &a ) );
+    check( 2 == histshare_pull( &b ) );
+    check( 0 == histshare_pull( &b ) );
+    static char const* const expa[] = { "one", "three", "two" };
+    static char const* const expb[] = { "two", "one", "three" };
+    int i = 0;
+    for( char const* e = history_oldest( &hista ); NULL != e; e = history_newer( &hista, e ) )
+        check( i < 3 && 0 == strcmp( e, expa[i++] ) );
+    check( 3 == i );
+    i = 0;
+    for( char const* e = history_oldest( &histb ); NULL != e; e = history_newer( &histb, e ) )
+        check( i < 3 && 0 == strcmp( e, expb[i++] ) );
+    check( 3 == i );
+    /* The pulled lines are not published again. */
+    check( 3 == share.head );
+    /* Each session navigates its own history. */
+    check( 0 == strcmp( "two", history_backward( &hista, "", 0 ) ) );
+    check( 0 == strcmp( "three", history_backward( &histb, "", 0 ) ) );
+    check( 0 == strcmp( "three", history_backward( &hista, "", 0 ) ) );
+    /* The lines overwritten in the ring are lost. */
+    char line[ linelen ];
+    for( int j = 0; j < 10; ++j ) {
+        sprintf( line, "line %d", j );
+        history_line( &hista, line );
+    }
+    check( numslots == histshare_pull( &b ) );
+    check( 0 == strcmp( "line 9", history_backward( &histb, "", 0 ) ) );
+    check( 0 == strcmp( "line 8", history_backward( &histb, "line", 4 ) ) );
+    check( 0 == strcmp( "line 7", history_backward( &histb, "line", 4 ) ) );
+    check( 0 == strcmp( "line 6", history_backward( &histb, "line", 4 ) ) );
+    check( NULL == history_backward( &histb, "line", 4 ) );
+    /* A slot in the middle of a publication stops the pull until it ends. */
+    history_line( &histb, "four" );
+    slots[ share.head & ( numslots - 1 ) ].state = 2 * share.head + 1;
+    ++share.head;
+    history_line( &histb, "five" );
+    check( 1 == histshare_pull( &a ) );
+    int const late = ( share.head - 2 ) & ( numslots - 1 );
+    strcpy( lines[ late ], "late" );
+    slots[ late ].owner = &b;
+    slots[ late ].state = 2 * ( share.head - 2 ) + 2;
+    check( 2 == histshare_pull( &a ) );
+    check( 0 == strcmp( "five", history_backward( &hista, "", 0 ) ) );
+    check( 0 == strcmp( "late", history_backward( &hista, "", 0 ) ) );
+    /* A slot that an older ticket still has stops the pull until the
+       publisher of its ticket takes it. */
+    long const ticket = share.head;
+    int const held = ticket & ( numslots - 1 );
+    slots[ held ].state = 2 * ( ticket - numslots ) + 1;
+    share.head = ticket + 1;
+    check( 0 == histshare_pull( &a ) && ticket == a.next );
+    ++slots[ held ].state;
+    share.head = ticket;
+    history_line( &histb, "six" );
+    check( 1 == histshare_pull( &a ) );
+    check( 0 == strcmp( "six", history_backward( &hista, "", 0 ) ) );
+    /* A slot still written by a lapped publisher is not taken, and the
+       lines after it are pulled once the ring laps it. */
+    int const lapped = share.head & ( numslots - 1 );
+    slots[ lapped ].state = 2 * ( share.head - numslots ) + 1;
+    history_line( &histb, "seven" );
+    check( 2 * ( share.head - 1 - numslots ) + 1 == slots[ lapped ].state );
+    history_line( &histb, "eight" );
+    check( 0 == histshare_pull( &a ) );
+    ++slots[ lapped ].state;
+    check( 0 == histshare_pull( &a ) );
+    for( int j = 1; j < numslots; ++j ) {
+        sprintf( line, "more %d", j );
+        history_line( &histb, line );
+    }
+    check( numslots == histshare_pull( &a ) );
+    check( 0 == strcmp( "more 3", history_backward( &hista, "", 0 ) ) );
+    check( 0 == strcmp( "eight", history_backward( &hista, "e", 1 ) ) );
+    check( NULL == history_backward( &hista, "seven", 5 ) );
+    done();
+}
+
+enum { publishers = 3, pullers = 2, sharelines = 50000, sharelen = 48 };
+
+/** Write a line of the shared history stress test.
+  * @param line Destination buffer of sharelen bytes.
+  * @param id   Index of the publisher.
+  * @param num  Number of the line of the publisher. */
+static void shareline( char* line, int id, int num ) {
+    int const len = sprintf( line, "%d:%d:", id, num );
+    int const end = len + ( id * 7 + num ) % ( sharelen - 1 - len );
+    for( int i = len; i < end; ++i )
+        line[i] = 'a' + ( id + num + i ) % 26;
+    line[ end ] = '\0';
+}
+
+struct sharer {
+    struct histsession session;
+    struct history hist;
+    struct historycfg cfg;
+    char mem[ 1024 ];
+    int id;
+    long* published;
+    int lines;
+    int bad;
+};
+
+/** Check a line pulled in the shared history stress test.
+  * It is the store function of the histories of the pullers. */
+static void sharecheck( void* p, char const* line, int len ) {
+    struct sharer* const sharer = p;
+    int id;
+    int num;
+    char expected[ sharelen ];
+    ++sharer->lines;
+    if( 2 != sscanf( line, "%d:%d:", &id, &num ) || 0 > id || id >= publishers || 0 > num || num >= sharelines ) {
+        ++sharer->bad;
+        return;
+    }
+    shareline( expected, id, num );
+    if( 0 != strcmp( expected, line ) || len != strlen( line ) )
+        ++sharer->bad;
+}
+
+/** Publish the lines of a publisher of the shared history stress test. */
+static void* sharepublish( void* p ) {
+    struct sharer* const sharer = p;
+    char line[ sharelen ];
+    for( int num = 0; num < sharelines; ++num ) {
+        shareline( line, sharer->id, num );
+        histshare_store( &sharer->session, line, strlen( line ) );
+    }
+    __atomic_add_fetch( sharer->published, 1, __ATOMIC_SEQ_CST );
+    return NULL;
+}
+
+/** Pull lines in the shared history stress test until all are published. */
+static void* sharepull( void* p ) {
+    struct sharer* const sharer = p;
+    while( publishers != __atomic_load_n( sharer->published, __ATOMIC_SEQ_CST ) )
+        histshare_pull( &sharer->session );
+    histshare_pull( &sharer->session );
+    return NULL;
+}
+
+static int historyShareThreads( void ) {
+    enum { numslots = 4, qty = publishers + pullers };
+    static struct histslot slots[ numslots ];
+    static char lines[ numslots ][ sharelen ];
+    struct histsharecfg const sharecfg = {
+        .slots    = slots,
+        .lines    = *lines,
+        .numslots = numslots,
+        .linelen  = sharelen
+    };
+    struct histshare share;
+    histshare_init( &share, &sharecfg );
+    static struct sharer sharer[ qty ];
+    long published = 0;
+    for( int i = 0; i < qty; ++i ) {
+        sharer[i].id        = i;
+        sharer[i].published = &published;
+        sharer[i].lines     = 0;
+        sharer[i].bad       = 0;
+        sharer[i].cfg       = (struct historycfg){
+            .lines   = sharer[i].mem,
+            .linelen = sharelen,
+            .size    = sizeof sharer[i].mem,
+            .store   = sharecheck,
+            .p       = &sharer[i]
+        };
+        history_init( &sharer[i].hist, &sharer[i].cfg );
+        histshare_session( &sharer[i].session, &share, &sharer[i].hist );
+    }
+    pthread_t threads[ qty ];
+    for( int i = 0; i < qty; ++i )
+        check( 0 == pthread_create( &threads[i], NULL, i < publishers ? sharepublish : sharepull, &sharer[i] ) );
+    for( int i = 0; i < qty; ++i )
+        check( 0 == pthread_join( threads[i], NULL ) );
+    /* Each line pulled is a whole line that was published. */
+    for( int i = publishers; i < qty; ++i ) {
+        check( 0 < sharer[i].lines );
+        check( 0 == sharer[i].bad );
+    }
+    check( publishers * sharelines == share.head );
+    done();
+}
+
+static int reverseSearch( void ) {
+    enum { size = 256, linelen = 32 };
+    char mem[ size ];
+    struct historycfg const histcfg = {
+        .lines   = mem,
+        .linelen = linelen,
+        .size    = size
+    };
+    struct history hist;
+    history_init( &hist, &histcfg );
+    static char const* const entries[] = {
+        "show status", "interface eth0 up", "set config x", "show version"
+    };
+    for( int i = 0; i < sizeof entries / sizeof *entries; ++i )
+        history_line( &hist, entries[i] );
+    /* The substring search goes on from the entry found. */
+    int at;
+    check( 0 == strcmp( "show version", history_search( &hist, "show", 4, 0, &at ) ) && 0 == at );
+    check( 0 == strcmp( "show version", history_search( &hist, "show", 4, 0, &at ) ) );
+    check( 0 == strcmp( "show status", history_search( &hist, "show", 4, 1, &at ) ) );
+    check( NULL == history_search( &hist, "show", 4, 1, &at ) );
+    check( 0 == strcmp( "show status", history_search( &hist, "stat", 4, 0, &at ) ) && 5 == at );
+    hist.pos = -1;
+    check( 0 == strcmp( "interface eth0 up", history_search( &hist, "eth0", 4, 0, &at ) ) && 10 == at );
+    check( NULL == history_search( &hist, "eth1", 4, 0, &at ) );
+    check( 0 == strcmp( "interface eth0 up", history_search( &hist, "e", 1, 0, &at ) ) );
+    /* Ctrl-R in the line capture. */
+    static struct { char const* input; char const* screen; char const* line; } const cases[] = {
+        { "\022eth",               "(reverse-i-search)`eth': interface eth0 up", "interface eth0 up" },
+        { "\022show\022",           "(reverse-i-search)`show': show status",      "show status"       },
+        { "\022show\022\022",       "(failed reverse-i-search)`show': show status", "show status"   },
+        { "\022versx\177",          "(reverse-i-search)`vers': show version",     "show version"      },
+        { "ab\022show\007",         "ab",                                         "ab"                },
+        { "\022sta\033[CX",         "show sXtatus",                               "show sXtatus"      },
+        { "\022conf\033[D\033[D-", "se-t config x",                              "se-t config x"     },
+    };
+    for( int i = 0; i < sizeof cases / sizeof *cases; ++i ) {
+        struct stream stream;
+        memset( &stream, 0, sizeof stream );
+        char line[ 64 ];
+        struct vt100 const vt100 = {
+            .p    = &stream,
+            .line = line,
+            .max  = sizeof line,
+            .hist = &hist,
+            .cols = 80
+        };
+        struct vt100state st;
+        vt100_init( &st, &vt100, echo_on );
+        vt100_feed( &st, cases[i].input, strlen( cases[i].input ), NULL );
+        char screen[ 128 ];
+        emulate( stream.output, screen, sizeof screen );
+        check( 0 == strcmp( screen, cases[i].screen ) );
+        vt100_char( &st, '\n' );
+        check( 0 == strcmp( line, cases[i].line ) );
+    }
+    done();
+}
+
+static int classes( void ) {
+    for( int c = 0; c < 256; ++c ) {
+        check( !ascii_is( c, ASCII_SPACE ) == !( c < 128 && isspace( c ) ) );
+        check( !ascii_is( c, ASCII_PRINT ) == !( c < 128 && isprint( c ) ) );
+        check( !ascii_is( c, ASCII_DIGIT ) == !( c < 128 && isdigit( c ) ) );
+        check( !ascii_is( c, ASCII_CTRL  ) == !( c < 128 && iscntrl( c ) ) );
+    }
+    /* A character of each class and another one out of it. */
+    static struct { int cls; char in; char out; } const lut [] = {
+        { ASCII_SPACE, '\v',   'a'  },
+        { ASCII_PRINT, '~',    '\t' },
+        { ASCII_DIGIT, '9',    'a'  },
+        { ASCII_CTRL,  '\033', 'a'  },
+    };
+    /* Runs of every length to cross the vector blocks at any offset. */
+    enum { size = 100 };
+    char buf[ size ];
+    for( int k = 0; k < sizeof lut / sizeof *lut; ++k ) {
+        int const cls = lut[k].cls;
+        for( int pos = 0; pos <= size; ++pos ) {
+            memset( buf, lut[k].out, size );
+            if( pos < size )
+                buf[pos] = lut[k].in;
+            check( pos == ascii_cspan( buf, size, cls ) );
+            check( ( pos < size ? size - pos - 1 : size ) == ascii_rcspan( buf, size, cls ) );
+            memset( buf, lut[k].out, size );
+            memset( buf, lut[k].in, pos );
+            check( pos == ascii_span( buf, size, cls ) );
+            memset( buf, lut[k].out, size );
+            memset( buf + size - pos, lut[k].in, pos );
+            check( pos == ascii_rspan( buf, size, cls ) );
+        }
+    }
+    done();
+}
+
 static int args( void ) {
     char line[] = "command argument1 \"\\targument \\\"2\\\"\" argument 3";
     static char const* const expected[] = {
@@ -384,11 +2165,38 @@ int main( void ) {
         { shiftBackSpaceEnd,    "Erase the last word"      },
         { shiftBackSpaceMiddle, "Erase a middle word"      },
         { delete,               "Delete key"               },
+        { sequences,            "ECMA-48 sequences"        },
         { home,                 "Home key"                 },
         { end,                  "End key"                  },
         { hintForward,          "Hint forward"             },
         { hintBackward,         "Hint backward"            },
+        { hintIndex,            "Indexed hints"            },
+        { hintCommon,           "Common prefix of hints"   },
+        { hintShare,            "Shared hints"             },
+        { hintShareThreads,     "Shared hints threads"     },
+        { hintHash,             "Perfect hash of hints"    },
+        { hintTree,             "Completion tree"          },
+        { hintFuzzy,            "Fuzzy hints"              },
+        { hintProvider,         "Hints provider"           },
+        { listing,              "Listing of hints"         },
+        { redraw,               "Differential redraw"      },
+        { gapBuffer,            "Edit with a gap buffer"   },
+        { growable,             "Growable line buffer"     },
+        { viewport,             "Horizontal scroll"        },
+        { paste,                "Bracketed paste"          },
+        { coalescing,           "Output coalescing"        },
+        { feed,                 "Feed a receive buffer"    },
+        { utf8,                 "UTF-8 editing"            },
         { history,              "History"                  },
+        { historyIndex,         "History prefix index"     },
+        { historyArena,         "History arena"            },
+        { historyDedup,         "History duplicates"       },
+        { historyLog,           "History log"              },
+        { historyFrontCoding,   "History front coding"     },
+        { historyShare,         "Shared history"           },
+        { historyShareThreads,  "Shared history threads"   },
+        { reverseSearch,        "Reverse search"           },
+        { classes,              "Character classes"        },
         { args,                 "Command line arguments"   }
     };
     return test_suit( tests, sizeof tests / sizeof *tests );
@@ -0,0 +1,275 @@
+
+/*
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+  SPDX-License-Identifier: MIT
+  Copyright (c) 2018 Rafa Garcia <rafagarcia77@gmail.com>.
+  Permission is hereby  granted, free of charge, to any  person obtaining a copy
+  of this software and associated  documentation files (the "Software"), to deal
+  in the Software  without restriction, including without  limitation the rights
+  to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+  copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+  IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+  FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+  AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+  LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+/*
+ * Generator of constant hints sets for sets known at build time.
+ * It reads a spec file with a command on each line, blank lines and lines
+ * that start with # are skipped, and writes a header with the hints set in
+ * constant tables: the commands, their index and a perfect hash table. So
+ * it can be in ROM and it needs no initialization. The header also has an
+ * enumeration with the position of each command to dispatch them. Its
+ * identifiers are the name of the set and the command with '_' in place of
+ * the other characters, so two commands that only differ in them, or a
+ * command that clashes with a table, are rejected.
+ * Usage: hintgen <name> <spec file> <header file>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "../hints.h"
+
+enum {
+    maxqty   = 4096, /**< Maximum number of commands.           */
+    maxlen   = 64,   /**< Maximum length of a command.          */
+    linelen  = 256,  /**< Maximum length of a line of a spec.   */
+    maxseeds = 4096  /**< Seeds tried for each size of the table. */
+};
+
+static char words[ maxqty ][ maxlen + 1 ];
+static char ids[ maxqty ][ maxlen + 1 ];
+static char const* idstrs[ maxqty ];
+static char const* strs[ maxqty ];
+static int order[ maxqty ];
+static short slots[ 4 * maxqty ];
+
+/** Read the commands of a spec file.
+  * @param name Name of the spec file.
+  * @return The number of commands or -1 on error. */
+static int readspec( char const* name ) {
+    FILE* const f = fopen( name, "r" );
+    if( NULL == f ) {
+        fprintf( stderr, "hintgen: can not open %s\n", name );
+        return -1;
+    }
+    int qty = 0;
+    char line[ linelen ];
+    for( int num = 1; NULL != fgets( line, sizeof line, f ); ++num ) {
+        size_t len = strcspn( line, "\r\n" );
+        if( '\0' == line[len] && !feof( f ) ) {
+            fprintf( stderr, "%s:%d: line too long\n", name, num );
+            qty = -1;
+            break;
+        }
+        for( ; 0 < len && isspace( (unsigned char)line[len-1] ); --len );
+        line[len] = '\0';
+        char const* word = line;
+        for( ; isspace( (unsigned char)*word ); ++word );
+        if( '\0' == *word || '#' == *word )
+            continue;
+        if( '\0' != word[ strcspn( word, " \t\"\\" ) ] ) {
+            fprintf( stderr, "%s:%d: a command is a word without quotes or backslashes\n", name, num );
+            qty = -1;
+            break;
+        }
+        if( maxlen < strlen( word ) ) {
+            fprintf( stderr, "%s:%d: command too long\n", name, num );
+            qty = -1;
+            break;
+        }
+        if( maxqty == qty ) {
+            fprintf( stderr, "%s:%d: too many commands\n", name, num );
+            qty = -1;
+            break;
+        }
+        strcpy( words[qty], word );
+        strs[qty] = words[qty];
+        ++qty;
+    }
+    fclose( f );
+    return qty;
+}
+
+/** Search a seed for a perfect hash table of a set of hints.
+  * @param hints The hints set.
+  * @param size  Number of slots. It is a power of two.
+  * @param seed  Destination of the seed found.
+  * @return Non-zero if a seed is found. The slots are set with it. */
+static int perfect( struct hints const* hints, int size, unsigned long* seed ) {
+    for( unsigned long s = 0; s < maxseeds; ++s ) {
+        for( int i = 0; i < size; ++i )
+            slots[i] = -1;
+        int i = 0;
+        for( ; i < hints->qty; ++i ) {
+            char const* const str = hints->str[i];
+            int const slot = hints_hashof( str, strlen( str ), s ) & ( size - 1 );
+            if( 0 <= slots[ slot ] )
+                break;
+            slots[ slot ] = i;
+        }
+        if( hints->qty == i ) {
+            *seed = s;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/** Get the suffix of the identifier of a command in the enumeration.
+  * Each character that can not be in an identifier is replaced by '_'.
+  * @param dest Destination of the suffix.
+  * @param str  The command. */
+static void identifier( char* dest, char const* str ) {
+    for( ; '\0' != *str; ++str, ++dest )
+        *dest = isalnum( (unsigned char)*str ) ? *str : '_';
+    *dest = '\0';
+}
+
+/** Compare two strings for qsort(). */
+static int cmpstr( void const* a, void const* b ) {
+    return strcmp( *(char const* const*)a, *(char const* const*)b );
+}
+
+/** Check that the identifiers of the commands are unique and that they do
+  * not clash with the ones of the tables of the hints set.
+  * @param spec  Name of the spec file.
+  * @param hints The hints set.
+  * @return Non-zero if there is not any clash. */
+static int uniqueids( char const* spec, struct hints const* hints ) {
+    static char const* const tables[] = { "qty", "str", "index", "slots", "hash" };
+    for( int i = 0; i < hints->qty; ++i ) {
+        identifier( ids[i], hints->str[i] );
+        idstrs[i] = ids[i];
+        for( int j = 0; j < (int)( sizeof tables / sizeof *tables ); ++j ) {
+            if( 0 == strcmp( ids[i], tables[j] ) ) {
+                fprintf( stderr, "%s: the identifier of %s clashes with the table %s\n",
+                         spec, hints->str[i], tables[j] );
+                return 0;
+            }
+        }
+    }
+    qsort( idstrs, hints->qty, sizeof *idstrs, cmpstr );
+    for( int i = 1; i < hints->qty; ++i ) {
+        if( 0 == strcmp( idstrs[i-1], idstrs[i] ) ) {
+            fprintf( stderr, "%s: two commands have the identifier %s\n", spec, idstrs[i] );
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/** Check that the name of a hints set is an identifier.
+  * @param name Name of the hints set.
+  * @return Non-zero if it is. */
+static int validname( char const* name ) {
+    if( !isalpha( (unsigned char)*name ) && '_' != *name )
+        return 0;
+    for( ; '\0' != *name; ++name )
+        if( !isalnum( (unsigned char)*name ) && '_' != *name )
+            return 0;
+    return 1;
+}
+
+/** Write the include guard of the header of a hints set.
+  * @param f    Destination file.
+  * @param name Name of the hints set. */
+static void guard( FILE* f, char const* name ) {
+    for( ; '\0' != *name; ++name )
+        fputc( toupper( (unsigned char)*name ), f );
+    fputs( "_H", f );
+}
+
+/** Write the header with the tables of a hints set.
+  * @param f     Destination file.
+  * @param name  Name of the hints set.
+  * @param spec  Name of the spec file.
+  * @param hints The hints set.
+  * @param size  Number of slots of the perfect hash table.
+  * @param seed  Seed of the perfect hash table. */
+static void writeheader( FILE* f, char const* name, char const* spec,
+                         struct hints const* hints, int size, unsigned long seed ) {
+    fprintf( f, "/* Generated by hintgen from %s. Do not edit. */\n", spec );
+    fprintf( f, "/* It has to be included after hints.h. */\n\n" );
+    fputs( "#ifndef ", f );
+    guard( f, name );
+    fputs( "\n#define ", f );
+    guard( f, name );
+    fputs( "\n\n", f );
+    fprintf( f, "/** Position of each command in %s. */\nenum %s_id {\n", name, name );
+    for( int i = 0; i < hints->qty; ++i )
+        fprintf( f, "    %s_%s,\n", name, ids[i] );
+    fprintf( f, "    %s_qty\n};\n\n", name );
+    fprintf( f, "static char const* const %s_str[] = {\n", name );
+    for( int i = 0; i < hints->qty; ++i )
+        fprintf( f, "    \"%s\",\n", hints->str[i] );
+    fprintf( f, "};\n\nstatic int const %s_index[] = {", name );
+    for( int i = 0; i < hints->qty; ++i )
+        fprintf( f, "%s%d,", 0 == i % 12 ? "\n    " : " ", hints->index[i] );
+    fprintf( f, "\n};\n\nstatic short const %s_slots[] = {", name );
+    for( int i = 0; i < size; ++i )
+        fprintf( f, "%s%d,", 0 == i % 12 ? "\n    " : " ", slots[i] );
+    fprintf( f, "\n};\n\n" );
+    fprintf( f, "static struct hintshash const %s_hash = {\n", name );
+    fprintf( f, "    .seed  = %lulu,\n    .size  = %d,\n    .slots = %s_slots\n};\n\n", seed, size, name );
+    fprintf( f, "static struct hints const %s = {\n", name );
+    fprintf( f, "    .str   = %s_str,\n    .qty   = %d,\n", name, hints->qty );
+    fprintf( f, "    .index = %s_index,\n    .hash  = &%s_hash\n};\n\n#endif\n", name, name );
+}
+
+int main( int argc, char** argv ) {
+    if( 4 != argc ) {
+        fprintf( stderr, "Usage: hintgen <name> <spec file> <header file>\n" );
+        return EXIT_FAILURE;
+    }
+    if( !validname( argv[1] ) ) {
+        fprintf( stderr, "hintgen: %s is not an identifier\n", argv[1] );
+        return EXIT_FAILURE;
+    }
+    int const qty = readspec( argv[2] );
+    if( 0 > qty )
+        return EXIT_FAILURE;
+    struct hints hints = { .str = strs, .qty = qty };
+    hints_index( &hints, order );
+    hints.index = order;
+    for( int i = 1; i < qty; ++i ) {
+        if( 0 == strcmp( strs[ order[i-1] ], strs[ order[i] ] ) ) {
+            fprintf( stderr, "%s: %s is repeated\n", argv[2], strs[ order[i] ] );
+            return EXIT_FAILURE;
+        }
+    }
+    if( !uniqueids( argv[2], &hints ) )
+        return EXIT_FAILURE;
+    int size = 1;
+    while( size < 2 * qty )
+        size *= 2;
+    unsigned long seed;
+    while( !perfect( &hints, size, &seed ) ) {
+        if( (int)( sizeof slots / sizeof *slots ) == size ) {
+            fprintf( stderr, "%s: no perfect hash table found\n", argv[2] );
+            return EXIT_FAILURE;
+        }
+        size *= 2;
+    }
+    FILE* const f = fopen( argv[3], "w" );
+    if( NULL == f ) {
+        fprintf( stderr, "hintgen: can not create %s\n", argv[3] );
+        return EXIT_FAILURE;
+    }
+    writeheader( f, argv[1], argv[2], &hints, size, seed );
+    if( 0 != fclose( f ) ) {
+        fprintf( stderr, "hintgen: can not write %s\n", argv[3] );
+        remove( argv[3] );
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
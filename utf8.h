@@ -0,0 +1,75 @@
+
+/*
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+  SPDX-License-Identifier: MIT
+  Copyright (c) 2018 Rafa Garcia <rafagarcia77@gmail.com>.
+  Permission is hereby  granted, free of charge, to any  person obtaining a copy
+  of this software and associated  documentation files (the "Software"), to deal
+  in the Software  without restriction, including without  limitation the rights
+  to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+  copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+  IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+  FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+  AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+  LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#ifndef UTF8_H
+#define UTF8_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/** Maximum length of an UTF-8 sequence. */
+#define UTF8_MAX 4
+
+/** Number of entries of a cache of widths. */
+#define UTF8_CACHESIZE 32
+
+/** Cache of the display widths of code points.
+  * It must be zero-initialized before its first use. */
+struct utf8_cache {
+    /** Code points shifted two bits to the left with their width. */
+    unsigned entry[ UTF8_CACHESIZE ];
+};
+
+/** Decode an UTF-8 sequence.
+  * Overlong sequences, surrogates and code points above U+10FFFF are invalid.
+  * @param str First byte of the sequence.
+  * @param len Number of bytes available.
+  * @param cp  Destination of the code point.
+  * @retval positive: The length of the sequence.
+  * @retval zero:     The sequence is not valid.
+  * @retval negative: The bytes are a valid start but the sequence is longer. */
+int utf8_decode( char const* str, int len, unsigned* cp );
+
+/** Get the number of bytes at the start of an array of printable text.
+  * The text is printable ASCII characters and valid UTF-8 sequences of
+  * printable code points. Runs of ASCII characters are vectorized.
+  * @param buf Array of bytes.
+  * @param len Length of the array.
+  * @return The position of the first byte that is not printable text or len.
+  *         It is never in the middle of an UTF-8 sequence. */
+int utf8_span( char const* buf, int len );
+
+/** Get the number of columns that a code point takes in a terminal.
+  * Combining and format characters take zero columns and wide or fullwidth
+  * characters of the East Asian Width property take two columns.
+  * @param cache Cache of widths.
+  * @param cp    The code point.
+  * @return 0, 1 or 2. */
+int utf8_width( struct utf8_cache* cache, unsigned cp );
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* UTF8_H */
+
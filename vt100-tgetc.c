@@ -32,11 +32,18 @@
 int vt100_getline( struct vt100 const* vt100, enum echo echo ) {
     struct vt100state st;
     vt100_init( &st, vt100, echo );
+    int const len = vt100_read( &st );
+    vt100_newline( &st );
+    return len;
+}
+
+/* Get blocked until capture a line with a state of line capture. */
+int vt100_read( struct vt100state* st ) {
     for(;;) {
-        int c = tgetc( vt100->p );
+        int c = tgetc( st->cfg->p );
         if( 0 > c )
             return c;
-        int len = vt100_char( &st, c );
+        int len = vt100_char( st, c );
         if ( 0 <= len )
             return len;
     }
@@ -22,11 +22,12 @@
 
 #include <stdio.h>
 #include <string.h>
-#include <ctype.h>
 #include <stdlib.h>
+#include <limits.h>
 
 #include "vt100.h"
 #include "terminal-io.h"
+#include "ascii.h"
 
 /** Look for the next word start in array of characters.
   * @param str Pointer to the first character in the array.
@@ -34,8 +35,8 @@
   * @param end Size if the array.
   * @return  The position of the next word start. */
 static int nextword( char const* str, int pos, int end ) {
-    for( ; pos < end && !isspace( str[pos] ); ++pos );
-    for( ; pos < end &&  isspace( str[pos] ); ++pos );
+    pos += ascii_cspan( str + pos, end - pos, ASCII_SPACE );
+    pos += ascii_span( str + pos, end - pos, ASCII_SPACE );
     return pos;
 }
 
@@ -44,223 +45,754 @@ static int nextword( char const* str, int pos, int end ) {
   * @param pos Actual position.
   * @return  The position of the previous word start. */
 static int prevword( char const* str, int pos ) {
-    for( ; pos > 0 &&  isspace( str[pos-1] ); --pos );
-    for( ; pos > 0 && !isspace( str[pos-1] ); --pos );
+    pos -= ascii_rspan( str, pos, ASCII_SPACE );
+    pos -= ascii_rcspan( str, pos, ASCII_SPACE );
     return pos;
 }
 
-/** It searches in a hints set the next matching hint.
-  * @param hints The hints set.
-  * @param str   String to search.
-  * @param len   Length of the string.
-  * @param h     Hint index where start to search.
-  * @return      The index of the hint found or -1 if there are not matches. */
-static int nexthint( struct hints const* hints, char const* str, int len, int h ) {
-    if( 0 == len )
-        return hints->qty == h + 1 ? 0 : h + 1;
-    for( int i = h + 1; i < hints->qty; ++i )
-        if ( 0 == memcmp( str, hints->str[i], len ) )
-            return i;
-    for( int i = 0; i < h; ++i )
-        if ( 0 == memcmp( str, hints->str[i], len ) )
-            return i;
-    return -1;
+/** Send all the output collected in a line capture.
+  * @param st State of line capture. */
+static void flush( struct vt100state* st ) {
+    if( 0 == st->txlen )
+        return;
+    tputn( st->tx, st->txlen, st->cfg->p );
+    st->txlen = 0;
 }
 
-/** It searches in a hints set the previous matching hint.
-  * @param hints The hints set.
-  * @param str   String to search.
-  * @param len   Length of the string.
-  * @param h     Hint index where start to search.
-  * @return      The index of the hint found or -1 if there are not matches. */
-static int prevhint( struct hints const* hints, char const* str, int len, int h ) {
-    if( 0 == len )
-        return 0 == h ? hints->qty - 1 : h - 1;
-    for( int i = h - 1; i >= 0; --i )
-        if ( 0 == memcmp( str, hints->str[i], len ) )
-            return i;
-    for( int i = hints->qty - 1; i > h; --i )
-        if ( 0 == memcmp( str, hints->str[i], len ) )
-            return i;
-    return -1;
+/** Add a character to the output of a line capture.
+  * @param st State of line capture.
+  * @param c  Character to be sent. */
+static void putch( struct vt100state* st, int c ) {
+    if( sizeof st->tx == st->txlen )
+        flush( st );
+    st->tx[ st->txlen++ ] = c;
+}
+
+/** Add a null-terminated string to the output of a line capture.
+  * @param st  State of line capture.
+  * @param str String to be sent. */
+static void putstr( struct vt100state* st, char const* str ) {
+    while( '\0' != *str )
+        putch( st, *str++ );
+}
+
+/** Add an array of characters to the output of a line capture.
+  * @param st  State of line capture.
+  * @param buf Characters to be sent.
+  * @param len Number of characters. */
+static void putn( struct vt100state* st, char const* buf, int len ) {
+    if( len > (int)sizeof st->tx - st->txlen ) {
+        flush( st );
+        if( len > (int)sizeof st->tx ) {
+            tputn( buf, len, st->cfg->p );
+            return;
+        }
+    }
+    memcpy( st->tx + st->txlen, buf, len );
+    st->txlen += len;
 }
 
 /** Move the cursor of the vt100 terminal n columns to the right or to the left.
-  * @param colunms Number of columns. Positive means to the right.
-  * @param p Parameter for printing */
-static void movecursor( int colunms, void* p  ) {
+  * @param st State of line capture.
+  * @param colunms Number of columns. Positive means to the right. */
+static void movecursor( struct vt100state* st, int colunms ) {
     switch( colunms ) {
         case 0:
             break;
         case -1:
-            tputs( "\033[D", p );
+            putch( st, '\b' );
             break;
         case 1:
-            tputs( "\033[C", p );
+            putstr( st, "\033[C" );
             break;
         default: {
             char buff[14];
             sprintf( buff, "\033[%d%c", abs( colunms ), 0 > colunms ? 'D' : 'C' );
-            tputs( buff, p );
+            putstr( st, buff );
             break;
         }
     }
 }
 
 /** Erase in the vt100 terminal from the cursor until the end of line.
-  * @param p Parameter for printing */
-static void eraseend( void* p ) {
-    tputs( "\033[K", p );
+  * @param st State of line capture. */
+static void eraseend( struct vt100state* st ) {
+    putstr( st, "\033[K" );
 }
 
-/** Move the cursor n columns forward.
-  * In st->param is the number of columns.
-  * @param st State of line capture. */
-static void cursorforward( struct vt100state* st ) {
-    int const param   = 0 == st->param ? 1 : st->param;
-    int const toend   = st->len - st->cur;
-    int const columns = toend < param ? toend : param;
-    if( echo_off != st->echo )
-        movecursor( columns, st->cfg->p );
-    st->cur += columns;
+/*
+ * Gap buffer.
+ * While a line is edited the characters before the cursor are at the start
+ * of the line buffer and the characters after the cursor are at its end.
+ * Inserting or removing characters at the cursor does not move any other
+ * character. Moving the cursor moves only the characters it jumps over.
+ * The line is joined in one piece when it is captured.
+ */
+
+/** Get the characters after the cursor.
+  * @param st State of line capture.
+  * @return Pointer to the first character after the cursor. */
+static char* after( struct vt100state const* st ) {
+    return st->line + st->max - ( st->len - st->cur );
 }
 
-/** Move the cursor n columns backward.
-  * In st->param is the number of columns.
+/** Move the gap of the line buffer to a new cursor position.
+  * @param st  State of line capture.
+  * @param pos New cursor position. */
+static void movegap( struct vt100state* st, int pos ) {
+    char* const line = st->line;
+    char* const tail = after( st );
+    if( pos < st->cur )
+        memmove( tail - ( st->cur - pos ), line + pos, st->cur - pos );
+    else
+        memmove( line + st->cur, tail, pos - st->cur );
+    st->cur = pos;
+}
+
+/** Join the characters before and after the cursor.
   * @param st State of line capture. */
-static void cursorbackward( struct vt100state* st ) {
-    int const param   = 0 == st->param ? 1 : st->param;
+static void joinline( struct vt100state* st ) {
+    memmove( st->line + st->cur, after( st ), st->len - st->cur );
+}
+
+/** Make room in the line buffer for more characters.
+  * The line buffer is enlarged only if the grow function is configured.
+  * Its size is doubled to keep linear the cost of long lines, but not over
+  * the maximum of an int: then it is not enlarged.
+  * @param st  State of line capture.
+  * @param len Number of characters to be added.
+  * @return Number of characters that can be added, up to len. */
+static int reserve( struct vt100state* st, int len ) {
+    int const room = st->max - 2 - st->len;
+    if( len <= room || NULL == st->cfg->grow )
+        return len < room ? len : room;
+    int max = 32 > st->max ? 32 : st->max;
+    while( max - 2 - st->len < len ) {
+        if( max > INT_MAX / 2 )
+            return room;
+        max *= 2;
+    }
+    char* const line = st->cfg->grow( st->line, max );
+    if( NULL == line )
+        return room;
+    int const tail = st->len - st->cur;
+    memmove( line + max - tail, line + st->max - tail, tail );
+    st->line = line;
+    st->max  = max;
+    return len;
+}
+
+/*
+ * UTF-8.
+ * The line buffer holds UTF-8 text and the positions are byte offsets at the
+ * start of a character. The cursor moves over cells, which are a character
+ * with the combining marks after it, and the terminal columns are counted
+ * with the display width of each character. While the line is only ASCII a
+ * byte is a cell and a column, so the count of non-ASCII bytes in the line
+ * selects the plain arithmetic of the ASCII case.
+ */
+
+/** Count the bytes of an array that are not ASCII.
+  * @param str Array of bytes.
+  * @param len Length of the array. */
+static int countnonascii( char const* str, int len ) {
+    int count = 0;
+    for( int i = 0; i < len; ++i )
+        count += 0x80 <= (unsigned char)str[i];
+    return count;
+}
+
+/** Shorten an array of UTF-8 text without splitting a sequence.
+  * @param str Array of bytes.
+  * @param len Length of the array.
+  * @param max Maximum length.
+  * @return The new length. */
+static int shorten( char const* str, int len, int max ) {
+    if( len <= max )
+        return len;
+    for( len = max; 0 < len && 0x80 == ( str[len] & 0xC0 ); --len );
+    return len;
+}
+
+/** Decode the character at the start of an array of the line.
+  * An invalid byte is taken as a character by itself.
+  * @param str First byte.
+  * @param len Number of bytes available.
+  * @param cp  Destination of the code point.
+  * @return Length of the character. */
+static int decode( char const* str, int len, unsigned* cp ) {
+    int const seqlen = utf8_decode( str, len, cp );
+    if( 0 < seqlen )
+        return seqlen;
+    *cp = (unsigned char)*str;
+    return 1;
+}
+
+/** Get the number of columns that a character takes in the terminal.
+  * In password mode each character is printed as one asterisk.
+  * @param st State of line capture.
+  * @param cp Code point. */
+static int charwidth( struct vt100state* st, unsigned cp ) {
+    if( 0x80 > cp || echo_pass == st->echo )
+        return 1;
+    return utf8_width( &st->widths, cp );
+}
+
+/** Get the number of columns that an array of characters takes in the terminal.
+  * @param st  State of line capture.
+  * @param str Array of characters.
+  * @param len Length of the array. */
+static int strwidth( struct vt100state* st, char const* str, int len ) {
+    int width = 0;
+    for( int i = 0; i < len; ) {
+        unsigned cp;
+        i += decode( str + i, len - i, &cp );
+        width += charwidth( st, cp );
+    }
+    return width;
+}
+
+/** Get the length of the combining marks at the start of an array.
+  * @param st  State of line capture.
+  * @param str Array of characters.
+  * @param len Length of the array. */
+static int skipmarks( struct vt100state* st, char const* str, int len ) {
+    int i = 0;
+    while( i < len && 0x80 <= (unsigned char)str[i] ) {
+        unsigned cp;
+        int const seqlen = decode( str + i, len - i, &cp );
+        if( 0 != charwidth( st, cp ) )
+            break;
+        i += seqlen;
+    }
+    return i;
+}
+
+/** Get the length of the cell at the start of an array.
+  * @param st  State of line capture.
+  * @param str Array of characters.
+  * @param len Length of the array. It is not zero. */
+static int nextcell( struct vt100state* st, char const* str, int len ) {
+    unsigned cp;
+    int const seqlen = decode( str, len, &cp );
+    return seqlen + skipmarks( st, str + seqlen, len - seqlen );
+}
+
+/** Get the length of the cell at the end of an array.
+  * @param st  State of line capture.
+  * @param str Array of characters.
+  * @param len Length of the array. It is not zero. */
+static int prevcell( struct vt100state* st, char const* str, int len ) {
+    int i = len;
+    while( 0 < i ) {
+        int start = i - 1;
+        while( 0 < start && UTF8_MAX > i - start && 0x80 == ( str[start] & 0xC0 ) )
+            --start;
+        unsigned cp;
+        if( start + decode( str + start, i - start, &cp ) != i ) {
+            --i;
+            break;
+        }
+        i = start;
+        if( 0 != charwidth( st, cp ) )
+            break;
+    }
+    return len - i;
+}
+
+/** Get the number of bytes of the cells at the start of an array that fit
+  * in a number of columns.
+  * @param st   State of line capture.
+  * @param str  Array of characters.
+  * @param len  Length of the array.
+  * @param cols Number of columns. */
+static int fit( struct vt100state* st, char const* str, int len, int cols ) {
+    int i = 0;
+    while( i < len ) {
+        int const celllen = nextcell( st, str + i, len - i );
+        cols -= strwidth( st, str + i, celllen );
+        if( 0 > cols )
+            break;
+        i += celllen;
+    }
+    return i;
+}
+
+/** Set the cursor in a position.
+  * It is moved after the combining marks that follow it, so it is never
+  * inside a cell. The terminal cursor is moved to it when the character
+  * is processed.
+  * @param st  State of line capture.
+  * @param pos New cursor position. */
+static void setcursor( struct vt100state* st, int pos ) {
+    movegap( st, pos );
+    if( 0 != st->nonascii )
+        movegap( st, pos + skipmarks( st, after( st ), st->len - pos ) );
+}
+
+/** Move the cursor n cells forward.
+  * @param st State of line capture.
+  * @param param Number of cells. Zero means one. */
+static void cursorforward( struct vt100state* st, int param ) {
+    param = 0 == param ? 1 : param;
+    int const toend = st->len - st->cur;
+    int cells = toend < param ? toend : param;
+    if( 0 != st->nonascii ) {
+        char const* const tail = after( st );
+        for( cells = 0; 0 < param && cells < toend; --param )
+            cells += nextcell( st, tail + cells, toend - cells );
+    }
+    setcursor( st, st->cur + cells );
+}
+
+/** Move the cursor n cells backward.
+  * @param st State of line capture.
+  * @param param Number of cells. Zero means one. */
+static void cursorbackward( struct vt100state* st, int param ) {
+    param = 0 == param ? 1 : param;
     int const tobegin = st->cur;
-    int const columns = tobegin < param ? tobegin : param;
-    if( echo_off != st->echo )
-        movecursor( -columns, st->cfg->p );
-    st->cur -= columns;
+    int cells = tobegin < param ? tobegin : param;
+    if( 0 != st->nonascii )
+        for( cells = 0; 0 < param && cells < tobegin; --param )
+            cells += prevcell( st, st->line, tobegin - cells );
+    setcursor( st, st->cur - cells );
+}
+
+/*
+ * Viewport.
+ * If the configuration sets the columns available for the line, the terminal
+ * shows only a window of the line. It starts at st->off and its width is one
+ * less than the columns, so the terminal cursor never wraps. The edits print
+ * only what falls inside the window while the cursor stays in it. When the
+ * cursor leaves it, the window is moved to center the cursor and redrawn, so
+ * the output of any key is bounded by the width of the terminal.
+ * Without columns the window has no end and the whole line is shown.
+ */
+
+/** Get the number of columns that a range of the line takes.
+  * @param st   State of line capture.
+  * @param from Position of the first character.
+  * @param to   Position after the last character. */
+static int columns( struct vt100state* st, int from, int to ) {
+    if( 0 == st->nonascii )
+        return to - from;
+    int width = 0;
+    if( from < st->cur ) {
+        int const end = to < st->cur ? to : st->cur;
+        width += strwidth( st, st->line + from, end - from );
+        from = end;
+    }
+    if( from < to )
+        width += strwidth( st, after( st ) + from - st->cur, to - from );
+    return width;
+}
+
+/** Get the position after the last character that fits in the window.
+  * Beyond the end of the line each position is one column.
+  * @param st State of line capture. */
+static int winend( struct vt100state* st ) {
+    if( 0 >= st->cfg->cols )
+        return INT_MAX;
+    int const width = st->cfg->cols - 1;
+    if( 0 == st->nonascii )
+        return st->off + width;
+    int pos = st->off;
+    int cols = width;
+    if( pos < st->cur ) {
+        int const len = fit( st, st->line + pos, st->cur - pos, cols );
+        cols -= strwidth( st, st->line + pos, len );
+        pos += len;
+        if( pos < st->cur )
+            return pos;
+    }
+    char const* const tail = after( st ) + pos - st->cur;
+    int const len = fit( st, tail, st->len - pos, cols );
+    cols -= strwidth( st, tail, len );
+    pos += len;
+    return pos < st->len ? pos : pos + cols;
+}
+
+/** Check if the cursor is in the window.
+  * @param st State of line capture. */
+static int inview( struct vt100state* st ) {
+    return st->off <= st->cur && st->cur <= winend( st );
+}
+
+/** Move the terminal cursor to a position of the line in the window.
+  * @param st  State of line capture.
+  * @param pos Position in the line. */
+static void gotopos( struct vt100state* st, int pos ) {
+    int const col = columns( st, st->off, pos );
+    movecursor( st, col - st->col );
+    st->col = col;
+}
+
+/** Print characters according to the echo mode at the terminal cursor.
+  * @param st  State of line capture.
+  * @param str Characters to be printed.
+  * @param len Number of characters. */
+static void echo( struct vt100state* st, char const* str, int len ) {
+    if( echo_on == st->echo )
+        putn( st, str, len );
+    else if( echo_pass == st->echo )
+        for( int i = 0; i < len; ++i )
+            if( 0x80 != ( str[i] & 0xC0 ) )
+                putch( st, '*' );
+    st->col += 0 == st->nonascii ? len : strwidth( st, str, len );
+}
+
+/** Print a range of the line. Only the part inside the window is printed.
+  * @param st   State of line capture.
+  * @param from Position of the first character.
+  * @param to   Position after the last character. */
+static void show( struct vt100state* st, int from, int to ) {
+    int const end = winend( st );
+    if( from < st->off )
+        from = st->off;
+    if( to > end )
+        to = end;
+    if( from >= to )
+        return;
+    gotopos( st, from );
+    if( from < st->cur ) {
+        int const len = ( to < st->cur ? to : st->cur ) - from;
+        echo( st, st->line + from, len );
+        from += len;
+    }
+    if( from < to )
+        echo( st, after( st ) + from - st->cur, to - from );
+}
+
+/** Print the line from a position to its end.
+  * Nothing is printed if the cursor is out of the window, because the
+  * whole window will be redrawn. The columns of the window that are left
+  * free by a wide character are erased.
+  * @param st    State of line capture.
+  * @param from  Position of the first character.
+  * @param erase Non-zero to erase what is left at the end of the line. */
+static void showtail( struct vt100state* st, int from, int erase ) {
+    if( echo_off == st->echo || !inview( st ) )
+        return;
+    show( st, from, st->len );
+    int const end = winend( st );
+    if( erase && st->len < end ) {
+        gotopos( st, st->len );
+        eraseend( st );
+    }
+    else if( end < st->len && columns( st, st->off, end ) < st->cfg->cols - 1 ) {
+        gotopos( st, end ); // A wide character does not fit in the last column
+        eraseend( st );
+    }
+}
+
+/** Check if a position of the line is inside a cell, before a combining mark.
+  * @param st  State of line capture.
+  * @param pos Position in the line. */
+static int midcell( struct vt100state* st, int pos ) {
+    if( 0 == st->nonascii || pos >= st->len )
+        return 0;
+    if( pos < st->cur )
+        return 0 != skipmarks( st, st->line + pos, st->cur - pos );
+    return 0 != skipmarks( st, after( st ) + pos - st->cur, st->len - pos );
+}
+
+/** Get the first position of a window with the cursor in its middle.
+  * @param st State of line capture. */
+static int center( struct vt100state* st ) {
+    int const half = ( st->cfg->cols - 1 ) / 2;
+    if( 0 == st->nonascii )
+        return st->cur > half ? st->cur - half : 0;
+    int pos = st->cur;
+    for( int width = 0; 0 < pos; ) {
+        int const celllen = prevcell( st, st->line, pos );
+        width += strwidth( st, st->line + pos - celllen, celllen );
+        if( width > half )
+            break;
+        pos -= celllen;
+    }
+    return pos;
+}
+
+/** Move the terminal cursor to the cursor.
+  * If it is out of the window or the window starts inside a cell, the
+  * window is moved and redrawn.
+  * @param st State of line capture. */
+static void view( struct vt100state* st ) {
+    if( echo_off == st->echo )
+        return;
+    if( !inview( st ) || midcell( st, st->off ) ) {
+        movecursor( st, -st->col );
+        st->col = 0;
+        st->off = center( st );
+        show( st, st->off, st->len );
+        eraseend( st );
+    }
+    gotopos( st, st->cur );
+}
+
+/*
+ * Differential redraw.
+ * Between two received characters the terminal shows exactly the line buffer,
+ * so before an edit is applied the line buffer is the shadow copy of the
+ * screen. The new content is compared with it and only the spans that differ
+ * are printed. Short runs of equal characters inside a changed span are
+ * reprinted because it is cheaper than a cursor movement.
+ */
+
+/** Equal characters below this length are reprinted instead of skipped. */
+enum { minskip = 5 };
+
+/** Print the characters after the cursor that differ from the actual ones
+  * when any of them is not ASCII. The characters at the same byte offset may
+  * be at different columns, so all of them are printed from the cell of the
+  * first difference on.
+  * @param st     State of line capture.
+  * @param old    Actual characters after the cursor.
+  * @param oldlen Number of actual characters.
+  * @param str    New characters.
+  * @param len    Number of new characters. */
+static void replacewide( struct vt100state* st, char const* old, int oldlen, char const* str, int len ) {
+    int const common = len < oldlen ? len : oldlen;
+    int i = 0;
+    for( ; i < common && old[i] == str[i]; ++i );
+    if( i == len && i == oldlen )
+        return;
+    for( ; 0 < i && i < len && 0x80 == ( str[i] & 0xC0 ); --i );
+    while( 0 < i && ( skipmarks( st, str + i, len - i ) || skipmarks( st, old + i, oldlen - i ) ) )
+        i -= prevcell( st, str, i ); // The cell before has other combining marks
+    int room = INT_MAX;
+    if( 0 < st->cfg->cols )
+        room = st->cfg->cols - 1 - columns( st, st->off, st->cur ) - strwidth( st, str, i );
+    if( 0 >= room )
+        return;
+    int const newfit = fit( st, str + i, len - i, room );
+    int const oldfit = fit( st, old + i, oldlen - i, room );
+    gotopos( st, st->cur + i );
+    echo( st, str + i, newfit );
+    if( strwidth( st, str + i, newfit ) < strwidth( st, old + i, oldfit ) )
+        eraseend( st );
+}
+
+/** Replace the characters after the cursor.
+  * Only the spans of the window that differ from the actual line are printed.
+  * The cursor keeps its position.
+  * @param st  State of line capture.
+  * @param str New characters. They may overlap the line buffer only if
+  *            they are not more than the actual ones.
+  * @param len Number of new characters. */
+static void replace( struct vt100state* st, char const* str, int len ) {
+    int const oldlen = st->len - st->cur;
+    if( len > oldlen )
+        len = shorten( str, len, oldlen + reserve( st, len - oldlen ) );
+    char const* const old = after( st );
+    int const oldnonascii = 0 == st->nonascii ? 0 : countnonascii( old, oldlen );
+    int const newnonascii = countnonascii( str, len );
+    st->nonascii += newnonascii - oldnonascii;
+    int const visible = echo_off != st->echo && inview( st );
+    if( visible && ( 0 != oldnonascii || 0 != newnonascii ) )
+        replacewide( st, old, oldlen, str, len );
+    else if( visible ) {
+        int const vis = winend( st ) - st->cur;
+        int const newvis = len < vis ? len : vis;
+        int const oldvis = oldlen < vis ? oldlen : vis;
+        int const common = newvis < oldvis ? newvis : oldvis;
+        for( int i = 0; i < common; ) {
+            if( old[i] == str[i] ) {
+                ++i;
+                continue;
+            }
+            int j = i + 1;
+            for(;;) {
+                for( ; j < common && old[j] != str[j]; ++j );
+                if( j == common )
+                    break;
+                int k = j;
+                for( ; k < common && old[k] == str[k]; ++k );
+                if( k - j >= minskip || ( k == common && newvis <= oldvis ) )
+                    break;
+                j = k;
+            }
+            gotopos( st, st->cur + i );
+            echo( st, str + i, j - i );
+            i = j;
+        }
+        if( newvis > oldvis ) {
+            gotopos( st, st->cur + oldvis );
+            echo( st, str + oldvis, newvis - oldvis );
+        }
+        else if( newvis < oldvis ) {
+            gotopos( st, st->cur + newvis );
+            eraseend( st );
+        }
+    }
+    memmove( st->line + st->max - len, str, len );
+    st->len = st->cur + len;
 }
 
 /** Add a character to the line. It is inserted in the position of the cursor.
   * @param st State of line capture.
   * @param c  Character value to be inserted. */
 static void addchar( struct vt100state* st, int c ) {
-    if( st->len + 2 >= st->cfg->max )
+    if( 0 == reserve( st, 1 ) )
         return;
-    if( st->cur < st->len )
-        eraseend( st->cfg->p );
-    for( int i = st->cur; i <= st->len; ++i ) {
-        if( echo_off != st->echo )
-            tputc( echo_pass == st->echo ? '*' : c, st->cfg->p );
-        int tmp = st->cfg->line[i];
-        st->cfg->line[i] = c;
-        c = tmp;
-    }
-    ++st->cur;
+    st->line[ st->cur++ ] = c;
     ++st->len;
-    if( echo_off != st->echo )
-        movecursor( st->cur - st->len, st->cfg->p );
+    showtail( st, st->cur - 1, 0 );
 }
 
-/** Remove the character before the cursor
+/** Add an UTF-8 sequence to the line. It is inserted in the position of the cursor.
+  * @param st  State of line capture.
+  * @param seq The sequence.
+  * @param len Length of the sequence. */
+static void addseq( struct vt100state* st, char const* seq, int len ) {
+    if( len > reserve( st, len ) )
+        return;
+    memcpy( st->line + st->cur, seq, len );
+    st->cur      += len;
+    st->len      += len;
+    st->nonascii += len;
+    showtail( st, st->cur - len, 0 );
+}
+
+/** Add an array of characters at the end of the line.
+  * The cursor has to be at the end of the line.
+  * @param st  State of line capture.
+  * @param str Characters to be added.
+  * @param len Number of characters. */
+static void append( struct vt100state* st, char const* str, int len ) {
+    len = shorten( str, len, reserve( st, len ) );
+    if( 0 >= len )
+        return;
+    memcpy( st->line + st->len, str, len );
+    st->nonascii += countnonascii( str, len );
+    int const from = st->len;
+    st->len += len;
+    st->cur = st->len;
+    showtail( st, from, 0 );
+}
+
+/** Remove the cell before the cursor
   * @param st State of line capture. */
 static void removechar( struct vt100state* st ) {
     if( 0 == st->cur )
         return;
-    if( echo_off != st->echo ) {
-        tputc( '\b', st->cfg->p );
-        eraseend( st->cfg->p );
+    int celllen = 1;
+    if( 0 != st->nonascii ) {
+        celllen = prevcell( st, st->line, st->cur );
+        st->nonascii -= countnonascii( st->line + st->cur - celllen, celllen );
     }
-    for( int i = st->cur; i < st->len; ++i ) {
-        st->cfg->line[i-1] = st->cfg->line[i];
-        if( echo_off != st->echo )
-            tputc( echo_pass == st->echo ? '*' : st->cfg->line[i], st->cfg->p );
-    }
-    --st->cur;
-    --st->len;
-    if( echo_off != st->echo )
-        movecursor( st->cur - st->len, st->cfg->p );
+    st->cur -= celllen;
+    st->len -= celllen;
+    showtail( st, st->cur, 1 );
 }
 
 /** Set the cursor to the first character of the line.
   * @param st State of line capture. */
 static void home( struct vt100state* st ) {
-    if( echo_off != st->echo )
-        movecursor( -st->cur, st->cfg->p );
-    st->cur = 0;
+    setcursor( st, 0 );
 }
 
 /** Set the cursor to the end of the line.
   * @param st State of line capture. */
 static void end( struct vt100state* st ) {
-    if( echo_off != st->echo )
-        movecursor( st->len - st->cur, st->cfg->p );
-    st->cur = st->len;
+    setcursor( st, st->len );
 }
 
-/** Remove the character after the cursor
+/** Remove the cell after the cursor
   * @param st State of line capture. */
 static void delete( struct vt100state* st ) {
     if( st->cur == st->len )
         return;
-    --st->len;
-    if( echo_off != st->echo )
-        eraseend( st->cfg->p );
-    for( int i = st->cur; i < st->len; ++i ) {
-        st->cfg->line[i] = st->cfg->line[i+1];
-        if( echo_off != st->echo )
-            tputc( echo_pass == st->echo ? '*' : st->cfg->line[i], st->cfg->p );
+    int celllen = 1;
+    if( 0 != st->nonascii ) {
+        char const* const tail = after( st );
+        celllen = nextcell( st, tail, st->len - st->cur );
+        st->nonascii -= countnonascii( tail, celllen );
     }
-    if( echo_off != st->echo )
-        movecursor( st->cur - st->len, st->cfg->p );
+    st->len -= celllen;
+    showtail( st, st->cur, 1 );
 }
 
 /** Move the cursor to the next word start.
   * @param st State of line capture. */
 static void movenextword( struct vt100state* st ) {
-    int const pos = nextword( st->cfg->line, st->cur, st->len );
-    movecursor( pos - st->cur, st->cfg->p );
-    st->cur = pos;
+    setcursor( st, st->cur + nextword( after( st ), 0, st->len - st->cur ) );
 }
 
 /** Move the cursor to the previous word start.
   * @param st State of line capture. */
 static void moveprevword( struct vt100state* st ) {
-    int const pos = prevword( st->cfg->line, st->cur );
-    movecursor( pos - st->cur, st->cfg->p );
-    st->cur = pos;
+    setcursor( st, prevword( st->line, st->cur ) );
 }
 
 /** Erase a complete word pointed by the cursor.
   * @param st State of line capture. */
-void eraseword( struct vt100state* st ) {
+static void eraseword( struct vt100state* st ) {
     if( echo_on != st->echo )
         return;
-    int const first = prevword( st->cfg->line, st->cur );
-    int const end   = nextword( st->cfg->line, first, st->len );
-    movecursor( first - st->cur, st->cfg->p );
-    int const oldlen = st->len;
-    st->len = st->cur = first;
-    eraseend( st->cfg->p );
-    memmove( st->cfg->line + first, st->cfg->line + end, oldlen - end );
-    int const wordlen = end - first;
-    int const newlen = oldlen - wordlen;
-    for( int i = first; i < newlen; ++i )
-        addchar( st, st->cfg->line[i] );
-    movecursor( first - newlen, st->cfg->p );
-    st->cur = first;
-}
-
-/** Erase form the cursor until the end of line.
-  * Concatenate a string.
-  * Restore the cursor to the the position before call this function.
+    moveprevword( st );
+    char const* const tail = after( st );
+    int const taillen = st->len - st->cur;
+    int wordlen = nextword( tail, 0, taillen );
+    if( 0 != st->nonascii )
+        wordlen += skipmarks( st, tail + wordlen, taillen - wordlen );
+    replace( st, tail + wordlen, taillen - wordlen );
+}
+
+/** Replace the characters from the cursor until the end of line.
+  * The cursor keeps its position.
   * @param st State of line capture.
-  * @param str String to be concatenated. */
+  * @param str Null-terminated string with the new characters. */
 static void refill( struct vt100state* st, char const* str ) {
-    eraseend( st->cfg->p );
-    if( NULL == str )
-        return;
-    int const pos = st->len = st->cur;
-    while( '\0' != *str )
-        addchar( st, *str++ );
-    st->cur = pos;
-    movecursor( st->cur - st->len, st->cfg->p );
+    replace( st, str, strlen( str ) );
+}
+
+/** Get the end of the word under the cursor for the hints.
+  * With a completion tree the word ends as in clarg_find(): at a space, or
+  * at the closing quote if it is quoted. Otherwise the hints apply to the
+  * whole line and it ends at the end of line.
+  * @param st State of line capture.
+  * @return Position after the last character of the word. */
+static int wordend( struct vt100state* st ) {
+    if( NULL == st->cfg->tree )
+        return st->len;
+    char const* const tail = after( st );
+    int const len = st->len - st->cur;
+    if( 0 == st->word || '\"' != st->line[ st->word - 1 ] )
+        return st->cur + ascii_cspan( tail, len, ASCII_SPACE );
+    int i = 0;
+    for( ; i < len && ' ' <= (unsigned char)tail[i] && '\"' != tail[i]; ++i )
+        if( '\\' == tail[i] && i + 1 < len )
+            ++i;
+    return st->cur + i;
+}
+
+/** Replace the characters from the cursor until the end of the word for
+  * the hints. The characters after the word are kept.
+  * The cursor keeps its position.
+  * @param st  State of line capture.
+  * @param str New characters.
+  * @param len Number of new characters.
+  * @return Number of characters written, less than len if they do not fit. */
+static int replaceword( struct vt100state* st, char const* str, int len ) {
+    int const cur = st->cur;
+    int const end = wordend( st );
+    if( end == st->len ) {
+        replace( st, str, len );
+        return st->len - cur;
+    }
+    int const oldlen = end - cur;
+    if( 0 != st->nonascii )
+        st->nonascii -= countnonascii( after( st ), oldlen );
+    st->len -= oldlen;
+    len = shorten( str, len, reserve( st, len ) );
+    memcpy( st->line + cur, str, len );
+    st->nonascii += countnonascii( str, len );
+    st->cur += len;
+    st->len += len;
+    showtail( st, cur, len < oldlen );
+    setcursor( st, cur );
+    return len;
 }
 
 /** Write in the line the next history entry that matches.
@@ -269,7 +801,7 @@ static void nextentry( struct vt100state* st ) {
     if( echo_on != st->echo || NULL == st->cfg->hist )
         return;
     st->fh = 0;
-    char const* entry = history_forward( st->cfg->hist, st->cfg->line, st->cur );
+    char const* entry = history_forward( st->cfg->hist, st->line, st->cur );
     refill( st, NULL == entry ? "" : entry + st->cur );
 }
 
@@ -282,80 +814,458 @@ static void preventry( struct vt100state* st ) {
         st->cfg->hist->pos = -1;
         st->fh = 0;
     }
-    char const* entry = history_backward( st->cfg->hist, st->cfg->line, st->cur );
+    char const* entry = history_backward( st->cfg->hist, st->line, st->cur );
     if( NULL != entry )
         refill( st, entry + st->cur );
 }
 
+/** Get the hints set of the configuration.
+  * A shared hints set is acquired once for each line, so the line keeps
+  * the same snapshot until it is captured even if it is replaced.
+  * @param st State of line capture.
+  * @return The hints set or null if there is not. */
+static struct hints const* basehints( struct vt100state* st ) {
+    if( NULL == st->cfg->share )
+        return st->cfg->hints;
+    if( NULL == st->snap )
+        st->snap = hintshare_acquire( st->cfg->share );
+    return NULL != st->snap ? &st->snap->hints : NULL;
+}
+
+/** Get the hints set for the line before the cursor.
+  * The candidates of the provider are kept while the line starts with the
+  * prefix they were got for, and they are narrowed in place as it grows.
+  * The provider is called again when the line does not start with it, or
+  * when there are no candidates left to check it with.
+  * @param st State of line capture.
+  * @return The hints set or null if there is not. */
+static struct hints const* hintset( struct vt100state* st ) {
+    if( NULL == st->cfg->provider )
+        return basehints( st );
+    struct hints* const set = &st->provided;
+    int from = st->candlen;
+    int const cached = 0 < set->qty && from <= st->cur
+                    && 0 == strncmp( st->cands[0], st->line, from );
+    if( !cached ) {
+        int qty = 0;
+        st->cands = st->cfg->provider( st->cfg->p, st->line, st->cur, &qty );
+        set->str = st->cands;
+        set->qty = NULL != st->cands ? qty : 0;
+        from = 0;
+    }
+    int qty = 0;
+    for( int i = 0; i < set->qty; ++i )
+        if( 0 == strncmp( st->cands[i] + from, st->line + from, st->cur - from ) )
+            st->cands[ qty++ ] = st->cands[i];
+    set->qty = qty;
+    st->candlen = st->cur;
+    return set;
+}
+
+/** Complete the line with the longest common prefix of the matching hints.
+  * The cursor is moved to the end of the completion.
+  * @param st State of line capture.
+  * @return Non-zero if the line is extended. */
+static int complete( struct vt100state* st ) {
+    char const* match;
+    int const typed = st->cur - st->word;
+    int len = hints_common( st->hints, st->line + st->word, typed, &match );
+    for( ; len > typed && 0x80 == ( match[len] & 0xC0 ); --len );
+    if( len <= typed )
+        return 0;
+    setcursor( st, st->cur + replaceword( st, match + typed, len - typed ) );
+    return 1;
+}
+
+/*
+ * Completion listing.
+ * On a double Tab the hints that match are listed below the line in columns
+ * as wide as the terminal, a page at a time. Each page is sent only when the
+ * user asks for it, so huge sets of matches do not flood the terminal link.
+ * While a listing is in progress the received keys only drive the pager.
+ * When it ends the prompt and the line are drawn again below it.
+ */
+
+/** Columns of the terminal assumed when they are not configured. */
+enum { listcols = 80 };
+
+/** Columns of blank between two columns of a listing. */
+enum { listgap = 2 };
+
+/** Get the next hint of a completion listing.
+  * @param st State of line capture with hints left to list.
+  * @return The hint. */
+static char const* nextlisted( struct vt100state* st ) {
+    struct hints const* hints = st->hints;
+    if( NULL != hints->index )
+        return hints->str[ hints->index[ st->list++ ] ];
+    for(;;) {
+        char const* hint = hints->str[ st->list++ ];
+        if( 0 == strncmp( hint, st->line + st->word, st->cur - st->word ) )
+            return hint;
+    }
+}
+
+/** Send blanks to the terminal.
+  * @param st  State of line capture.
+  * @param qty Number of blanks. */
+static void blanks( struct vt100state* st, int qty ) {
+    static char const blank[] = "                ";
+    for( ; 0 < qty; qty -= sizeof blank - 1 )
+        putn( st, blank, qty < (int)sizeof blank - 1 ? qty : (int)sizeof blank - 1 );
+}
+
+/** Draw again the prompt and the line at the start of a terminal line.
+  * @param st State of line capture. */
+static void redraw( struct vt100state* st ) {
+    if( NULL != st->cfg->prompt )
+        putstr( st, st->cfg->prompt );
+    st->col = 0;
+    show( st, st->off, st->len );
+    eraseend( st );
+    view( st );
+}
+
+/** Finish a completion listing and draw again the prompt and the line.
+  * @param st State of line capture. */
+static void endlist( struct vt100state* st ) {
+    st->list = -1;
+    st->tabs = 0;
+    redraw( st );
+}
+
+/** Send the next page of a completion listing.
+  * It has as many lines as the terminal rows except one that is left for
+  * the prompt of the pager. Each hint is cut to the column width.
+  * @param st State of line capture. */
+static void listpage( struct vt100state* st ) {
+    int const cols = 0 < st->cfg->cols ? st->cfg->cols : listcols;
+    int const percol = cols / st->listw;
+    int lines = 1 < st->cfg->rows ? st->cfg->rows - 1 : 1;
+    for( ; 0 < lines && 0 < st->listleft; --lines ) {
+        for( int i = 0; i < percol && 0 < st->listleft; ++i ) {
+            char const* hint = nextlisted( st );
+            int const len = fit( st, hint, strlen( hint ), st->listw - listgap );
+            putn( st, hint, len );
+            if( i + 1 < percol && 1 < st->listleft )
+                blanks( st, st->listw - strwidth( st, hint, len ) );
+            --st->listleft;
+        }
+        putstr( st, "\r\n" );
+    }
+    if( 0 == st->listleft ) {
+        endlist( st );
+        return;
+    }
+    char buff[32];
+    sprintf( buff, "\033[7m--More-- %d\033[0m", st->listleft );
+    putstr( st, buff );
+}
+
+/** Start a completion listing of the hints that match the line.
+  * @param st State of line capture. */
+static void startlist( struct vt100state* st ) {
+    int first;
+    int const qty = hints_count( st->hints, st->line + st->word, st->cur - st->word, &first );
+    if( 0 >= qty )
+        return;
+    st->list = 0 > first ? 0 : first;
+    int width = 0;
+    for( int i = 0; i < qty; ++i ) {
+        char const* hint = nextlisted( st );
+        int const w = strwidth( st, hint, strlen( hint ) );
+        if( width < w )
+            width = w;
+    }
+    int const cols = 0 < st->cfg->cols ? st->cfg->cols : listcols;
+    st->listw = width + listgap < cols ? width + listgap : cols;
+    st->list = 0 > first ? 0 : first;
+    st->listleft = qty;
+    putstr( st, "\r\n" );
+    listpage( st );
+}
+
+/** Process a received key while a completion listing is in progress.
+  * Space, Tab and Enter show the next page and 'q' ends the listing. Any
+  * other key ends the listing and then it is processed as usual, so for
+  * example a bracketed paste that starts in the pager is not lost.
+  * @param st     State of line capture.
+  * @param action Action of the escape sequence parser.
+  * @param c      The received character.
+  * @return Non-zero if the key was used by the pager. */
+static int pager( struct vt100state* st, int action, int c ) {
+    if( ECMA48_NONE == action )
+        return 1;
+    int const more = ( ECMA48_PRINT == action && ' ' == c )
+                  || ( ECMA48_EXECUTE == action && ( '\t' == c || '\r' == c || '\n' == c ) );
+    if( more ) {
+        putstr( st, "\r" );
+        eraseend( st );
+        listpage( st );
+        return 1;
+    }
+    putstr( st, "\r" );
+    eraseend( st );
+    endlist( st );
+    return ECMA48_PRINT == action && 'q' == c;
+}
+
+/** Write in the line the next hint of a fuzzy search.
+  * The word before the cursor is the pattern of the first Tab. It is kept
+  * while the next Tabs cycle through the matches in order of score, each
+  * one replacing the word, or the rest of the line without a completion tree.
+  * @param st State of line capture.
+  * @param forward non-zero forward or zero backward. */
+static void fuzzy( struct vt100state* st, int forward ) {
+    if( 0 > st->patlen ) {
+        if( HINTS_FUZZYMAX < st->cur - st->word )
+            return;
+        st->patlen = st->cur - st->word;
+        memcpy( st->pattern, st->line + st->word, st->patlen );
+        st->h = -1;
+    }
+    int const h = ( forward ? hints_fuzzynext : hints_fuzzyprev )( st->hints, st->pattern, st->patlen, st->h );
+    if( 0 > h )
+        return;
+    st->h = h;
+    setcursor( st, st->word );
+    char const* const str = st->hints->str[ h ];
+    setcursor( st, st->cur + replaceword( st, str, strlen( str ) ) );
+}
+
+/** Get the hints for the line before the cursor and where they apply.
+  * With a completion tree they apply to the word under the cursor and
+  * otherwise to the whole line. A fuzzy search gets all the candidates of
+  * the provider, as the matches need not start with the line.
+  * @param st State of line capture.
+  * @return The hints set or null if there is not. */
+static struct hints const* hintsfor( struct vt100state* st ) {
+    st->word = 0;
+    if( NULL != st->cfg->tree )
+        return hints_tree( st->cfg->tree, st->line, st->cur, &st->word );
+    if( !st->cfg->fuzzy )
+        return hintset( st );
+    if( NULL == st->cfg->provider )
+        return basehints( st );
+    int qty = 0;
+    st->cands = st->cfg->provider( st->cfg->p, st->line, 0, &qty );
+    st->provided.str = st->cands;
+    st->provided.qty = NULL != st->cands ? qty : 0;
+    st->candlen = 0;
+    return &st->provided;
+}
+
 /** Write in the line the next hints that matches.
+  * Going forward, the line is completed first up to the longest common
+  * prefix of the matches. Once it is, the matches are cycled, or listed on
+  * a second Tab if the terminal rows are configured.
   * @param st State of line capture.
   * @param forward non-zero forward or zero backward. */
 static void hint( struct vt100state* st, int forward ) {
-    if( echo_on != st->echo || NULL == st->cfg->hints )
+    if( echo_on != st->echo )
+        return;
+    if( st->cfg->fuzzy && 0 <= st->patlen ) {
+        fuzzy( st, forward );
+        return;
+    }
+    struct hints const* const hints = hintsfor( st );
+    if( NULL == hints )
+        return;
+    if( hints != st->hints || st->h >= hints->qty )
+        st->h = 0;
+    st->hints = hints;
+    if( st->cfg->fuzzy ) {
+        fuzzy( st, forward );
+        return;
+    }
+    if( forward && complete( st ) ) {
+        st->tabs = 1;
         return;
-    int const h = ( forward ? nexthint : prevhint )( st->cfg->hints, st->cfg->line, st->cur, st->h );
+    }
+    if( forward && 0 < st->cfg->rows ) {
+        if( st->tabs++ )
+            startlist( st );
+        return;
+    }
+    int const h = ( forward ? hints_next : hints_prev )( st->hints, st->line + st->word, st->cur - st->word, st->h );
     if( 0 > h )
         return;
     st->h =  h;
-    refill( st, st->cfg->hints->str[ h ] + st->cur );
+    char const* const str = st->hints->str[ h ] + st->cur - st->word;
+    replaceword( st, str, strlen( str ) );
 }
 
-/** Process a VT100 command: <ESC>[num~
+/** Start a bracketed paste.
   * @param st State of line capture. */
-static void cursorctrl( struct vt100state* st ) {
-    switch( st->param ) {
-        case 1: home( st );   break; // Home key
-        case 3: delete( st ); break; // Delete key
-        case 4: end( st );    break; // End key
+static void startpaste( struct vt100state* st ) {
+    st->mark  = st->cur;
+    st->paste = 1;
+}
+
+/** Add pasted characters to the line.
+  * Tabs and line breaks are stored as spaces and other control
+  * characters are discarded. The UTF-8 sequences have to be complete.
+  * Nothing is printed until the paste ends.
+  * @param st  State of line capture.
+  * @param str Pasted characters.
+  * @param len Number of pasted characters. */
+static void pastechars( struct vt100state* st, char const* str, int len ) {
+    len = shorten( str, len, reserve( st, len ) );
+    for( int i = 0; i < len; ++i ) {
+        int c = (unsigned char)str[i];
+        if( '\t' == c || '\r' == c || '\n' == c )
+            c = ' ';
+        else if( 0x80 > c && !ascii_is( c, ASCII_PRINT ) )
+            continue;
+        st->line[ st->cur++ ] = c;
+        st->nonascii += 0x80 <= c;
+        ++st->len;
     }
 }
 
-/** Process a VT100 command: <ESC>[{num}{char}
-  * @param st State of line capture.
-  * @param c Character ID of VT100 command.
-  * @param a Parameter of VT100 command. */
-static void escapeSquareBracket( struct vt100state* st, int c ) {
-    switch( c ) {
-        case '~': cursorctrl( st );     break;
-        case 'A': preventry( st );      break; // Arrow Up
-        case 'B': nextentry( st );      break; // Arrow Down
-        case 'C': cursorforward( st );  break; // Arrow Right
-        case 'D': cursorbackward( st ); break; // Arrow Left
-        case 'Z': hint( st, 0 );        break; // Shift + Tab
+/** Finish a bracketed paste.
+  * The line is printed once from the position where the paste started.
+  * @param st State of line capture. */
+static void endpaste( struct vt100state* st ) {
+    st->paste = 0;
+    showtail( st, st->mark, 0 );
+}
+
+/** Keys decoded from escape sequences. */
+enum key {
+    KEY_NONE,
+    KEY_UP,
+    KEY_DOWN,
+    KEY_RIGHT,
+    KEY_LEFT,
+    KEY_WORDRIGHT,
+    KEY_WORDLEFT,
+    KEY_HOME,
+    KEY_END,
+    KEY_DELETE,
+    KEY_BACKTAB,
+    KEY_PASTESTART,
+    KEY_PASTEEND,
+};
+
+/** Process a key decoded from an escape sequence.
+  * @param st    State of line capture.
+  * @param key   The key, see enum key.
+  * @param count Number of times the key is repeated. */
+static void keyevent( struct vt100state* st, int key, int count ) {
+    if( st->paste ) {
+        if( KEY_PASTEEND == key )
+            endpaste( st );
+        return;
+    }
+    switch( key ) {
+        case KEY_UP:         preventry( st );              break;
+        case KEY_DOWN:       nextentry( st );              break;
+        case KEY_RIGHT:      cursorforward( st, count );   break;
+        case KEY_LEFT:       cursorbackward( st, count );  break;
+        case KEY_HOME:       home( st );                   break;
+        case KEY_END:        end( st );                    break;
+        case KEY_DELETE:     delete( st );                 break;
+        case KEY_BACKTAB:    hint( st, 0 );                break;
+        case KEY_PASTESTART: startpaste( st );             break;
+        case KEY_WORDRIGHT:
+            if( echo_on == st->echo )
+                movenextword( st );
+            break;
+        case KEY_WORDLEFT:
+            if( echo_on == st->echo )
+                moveprevword( st );
+            break;
     }
 }
 
-/** Process a VT100 command: <ESC>O{char}
+/** Decode a control sequence: <ESC>[{params}{char}
+  * The arrows with a modifier parameter, like <ESC>[1;5C, move by words.
   * @param st State of line capture.
-  * @param c Character ID of VT100 command.  */
-static void escapeBigO( struct vt100state* st, int c ) {
-    if( echo_on != st->echo )
+  * @param c  Final character of the sequence. */
+static void csi( struct vt100state* st, int c ) {
+    struct ecma48 const* const esc = &st->esc;
+    if( 0 != esc->prefix || 0 != esc->inter )
         return;
+    int const count    = 1 == esc->qty ? esc->param[0] : 1;
+    int const modified = 1 < esc->qty && 1 < esc->param[1];
     switch( c ) {
-        case 'C': movenextword( st ); break; // Shift + Right Arrow
-        case 'D': moveprevword( st ); break; // Shift + Left Arrow
+        case 'A': keyevent( st, KEY_UP, 1 ); break;
+        case 'B': keyevent( st, KEY_DOWN, 1 ); break;
+        case 'C': keyevent( st, modified ? KEY_WORDRIGHT : KEY_RIGHT, count ); break;
+        case 'D': keyevent( st, modified ? KEY_WORDLEFT : KEY_LEFT, count ); break;
+        case 'H': keyevent( st, KEY_HOME, 1 ); break;
+        case 'F': keyevent( st, KEY_END, 1 ); break;
+        case 'Z': keyevent( st, KEY_BACKTAB, 1 ); break;
+        case '~': {
+            static struct { short code; short key; } const lut [] = {
+                { 1, KEY_HOME }, { 7, KEY_HOME }, { 4, KEY_END }, { 8, KEY_END },
+                { 3, KEY_DELETE }, { 200, KEY_PASTESTART }, { 201, KEY_PASTEEND }
+            };
+            for( int i = 0; i < sizeof lut / sizeof *lut; ++i )
+                if( lut[i].code == esc->param[0] )
+                    keyevent( st, lut[i].key, 1 );
+            break;
+        }
     }
 }
 
-/** State codes of line capture. */
-enum state {
-    CHAR,    /**< Waiting for a print character or escape. */
-    ESCAPE,  /**< Escape character is received.            */
-    BRACKET, /**< Received <ESC>[                          */
-    BIG_O,   /**< Received <ESC>O                          */
-};
+/** Decode a SS3 sequence: <ESC>O{char}
+  * @param st State of line capture.
+  * @param c  Character after <ESC>O. */
+static void ss3( struct vt100state* st, int c ) {
+    switch( c ) {
+        case 'A': keyevent( st, KEY_UP, 1 );        break;
+        case 'B': keyevent( st, KEY_DOWN, 1 );      break;
+        case 'C': keyevent( st, KEY_WORDRIGHT, 1 ); break; // Shift + Right Arrow
+        case 'D': keyevent( st, KEY_WORDLEFT, 1 );  break; // Shift + Left Arrow
+        case 'H': keyevent( st, KEY_HOME, 1 );      break;
+        case 'F': keyevent( st, KEY_END, 1 );       break;
+    }
+}
 
 /*  Initialize a state of line capture. */
 void vt100_init( struct vt100state* st, struct vt100 const* vt100, enum echo echo ) {
     *st = ( struct vt100state ) {
+        .txlen = 0,
         .len   = 0,
         .cur   = 0,
+        .off   = 0,
+        .col   = 0,
         .h     = 0,
-        .state = CHAR,
+        .paste = 0,
+        .mblen = 0,
         .cfg   = vt100,
+        .line  = vt100->line,
+        .max   = vt100->max,
         .echo  = echo,
-        .fh    = 1
+        .fh    = 1,
+        .list  = -1,
+        .tabs  = 0,
+        .patlen = -1,
+        .qlen  = -1,
+        .found = NULL,
+        .hints = vt100->hints,
+        .word  = 0,
+        .snap  = NULL,
+        .cands = NULL,
+        .candlen  = 0,
+        .provided = { .qty = 0 },
+        .nonascii = 0
     };
+    ecma48_init( &st->esc );
+}
+
+/* Start a session of line captures in a terminal. */
+void vt100_start( struct vt100 const* vt100 ) {
+    static char const enable[] = "\033[?2004h"; // Bracketed paste mode
+    tputn( enable, sizeof enable - 1, vt100->p );
+}
+
+/* End a session of line captures in a terminal. */
+void vt100_stop( struct vt100 const* vt100 ) {
+    static char const disable[] = "\033[?2004l"; // Bracketed paste mode
+    tputn( disable, sizeof disable - 1, vt100->p );
 }
 
 /* Discard all received and star a new line capture. */
@@ -363,76 +1273,303 @@ void vt100_newline( struct vt100state* st ) {
     st->len = 0;
     st->cur = 0;
     st->h   = 0;
+    st->off = 0;
+    st->col = 0;
+    st->nonascii = 0;
+    st->mblen    = 0;
+    st->list     = -1;
+    st->tabs     = 0;
+    st->patlen   = -1;
+    st->qlen     = -1;
+    st->found    = NULL;
+    st->candlen  = 0;
+    st->provided.qty = 0;
+    if( NULL != st->snap ) {
+        hintshare_release( st->snap );
+        st->snap = NULL;
+    }
 }
 
 /** Control keys codes used. */
 enum ctrlkey {
+    BEL =   7, /**< Ctrl + G  */
     BS  =   8, /**< Backspace */
     TAB =   9, /**< Tabulate  */
-    ESC =  27, /**< Escape    */
+    DC2 =  18, /**< Ctrl + R  */
     DEL = 127, /**< Delete    */
 };
 
-/* Process a received character in a line capture. */
-int vt100_char( struct vt100state* st, int c ) {
+/*
+ * Reverse incremental search.
+ * Ctrl-R starts a search of the history entries that contain the query,
+ * from the newest to the oldest. Each printable character is added to the
+ * query and the search goes on from the entry found, Backspace removes the
+ * last character and searches again from the newest entry, and Ctrl-R
+ * searches an older entry. The search line replaces the prompt until the
+ * search ends. Ctrl-G ends it and restores the line. Any other key writes
+ * the entry found in the line, with the cursor at the match, and then it
+ * is processed as usual, so Enter captures the entry found.
+ */
 
-    if( '\n' == c || '\r' == c ) {
-        tputs( "\r\n", st->cfg->p );
-        st->cfg->line[st->len] = '\0';
-        if( NULL != st->cfg->hist )
-            history_line( st->cfg->hist, st->cfg->line );
-        int const len = st->len;
-        vt100_newline( st );
-        return len;
+/** Draw the search line with the query and the entry found.
+  * @param st     State of line capture.
+  * @param failed Non-zero if the last search did not find the query. */
+static void drawsearch( struct vt100state* st, int failed ) {
+    char const* const str = failed ? "(failed reverse-i-search)`" : "(reverse-i-search)`";
+    putstr( st, "\r" );
+    putstr( st, str );
+    putn( st, st->query, st->qlen );
+    putstr( st, "': " );
+    if( NULL != st->found ) {
+        int len = strlen( st->found );
+        if( 0 < st->cfg->cols ) {
+            int const room = st->cfg->cols - 1 - (int)strlen( str ) - st->qlen - 3;
+            len = 0 < room ? fit( st, st->found, len, room ) : 0;
+        }
+        putn( st, st->found, len );
+    }
+    eraseend( st );
+}
+
+/** Search the query in the history and draw the search line.
+  * The entry found is kept if the query is not found.
+  * @param st    State of line capture in a search.
+  * @param older Non-zero to search an entry older than the one found. */
+static void research( struct vt100state* st, int older ) {
+    if( 0 == st->qlen ) {
+        st->found = NULL;
+        drawsearch( st, 0 );
+        return;
+    }
+    int at;
+    char const* const entry = history_search( st->cfg->hist, st->query, st->qlen, older, &at );
+    if( NULL != entry ) {
+        st->found   = entry;
+        st->foundat = at;
     }
+    drawsearch( st, NULL == entry );
+}
 
-    switch( st->state ) {
+/** Start a reverse incremental search.
+  * @param st State of line capture. */
+static void startsearch( struct vt100state* st ) {
+    if( echo_on != st->echo || NULL == st->cfg->hist )
+        return;
+    st->qlen  = 0;
+    st->found = NULL;
+    st->cfg->hist->pos = -1;
+    drawsearch( st, 0 );
+}
 
-        case CHAR: {
-            switch( c ) {
-                case ESC: st->state = ESCAPE; break; // Escape
-                case DEL: removechar( st );   break; // Backspace
-                case TAB: hint( st, 1 );      break; // Tab
-                case BS:  eraseword( st );    break; // Shift + backspace
-                default:
-                    if ( isprint( c ) )
-                        addchar( st, c );
-            }
-            break;
+/** Finish a reverse incremental search and draw again the prompt and the line.
+  * @param st   State of line capture in a search.
+  * @param load Non-zero to write the entry found in the line. */
+static void endsearch( struct vt100state* st, int load ) {
+    if( load && NULL != st->found ) {
+        int const len = strlen( st->found );
+        movegap( st, 0 );
+        st->len = 0;
+        int const cut = shorten( st->found, len, reserve( st, len ) );
+        memcpy( st->line + st->max - cut, st->found, cut );
+        st->len = cut;
+        st->nonascii = countnonascii( st->found, cut );
+        st->off = 0;
+        setcursor( st, st->foundat < cut ? st->foundat : cut );
+    }
+    st->qlen  = -1;
+    st->found = NULL;
+    putstr( st, "\r" );
+    eraseend( st );
+    redraw( st );
+}
+
+/** Process a received key while a reverse incremental search is in progress.
+  * @param st     State of line capture.
+  * @param action Action of the escape sequence parser.
+  * @param c      The received character.
+  * @return Non-zero if the key is processed or zero if it ended the search
+  *         and it has to be processed as usual. */
+static int searchkey( struct vt100state* st, int action, int c ) {
+    if( ECMA48_NONE == action )
+        return 1;
+    if( ECMA48_PRINT == action ) {
+        if( 0x80 > c && ascii_is( c, ASCII_PRINT ) && VT100_QUERYMAX > st->qlen ) {
+            st->query[ st->qlen++ ] = c;
+            research( st, 0 );
         }
+        return 1;
+    }
+    if( ECMA48_EXECUTE == action && DC2 == c ) {
+        if( 0 != st->qlen )
+            research( st, 1 );
+        return 1;
+    }
+    if( ECMA48_EXECUTE == action && DEL == c ) {
+        if( 0 != st->qlen ) {
+            --st->qlen;
+            st->cfg->hist->pos = -1;
+            research( st, 0 );
+        }
+        return 1;
+    }
+    if( ECMA48_EXECUTE == action && BEL == c ) {
+        endsearch( st, 0 );
+        return 1;
+    }
+    endsearch( st, 1 );
+    return 0;
+}
+
+/** Complete the line capture.
+  * @param st State of line capture.
+  * @return The length of the line. */
+static int newline( struct vt100state* st ) {
+    putstr( st, "\r\n" );
+    joinline( st );
+    st->line[st->len] = '\0';
+    if( NULL != st->cfg->hist )
+        history_line( st->cfg->hist, st->line );
+    int const len = st->len;
+    vt100_newline( st );
+    return len;
+}
+
+/** Process a received control character.
+  * @param st State of line capture.
+  * @param c  The received character.
+  * @retval  non-negative: The line is just captured. The value is the length.
+  * @retval negative:      Waiting for another character. */
+static int control( struct vt100state* st, int c ) {
+    if( st->paste ) {
+        char const ch = c;
+        pastechars( st, &ch, 1 );
+        return -1;
+    }
+    switch( c ) {
+        case '\n':
+        case '\r': return newline( st );
+        case DEL:  removechar( st );  break; // Backspace
+        case TAB:  hint( st, 1 );     break; // Tab
+        case BS:   eraseword( st );   break; // Shift + backspace
+        case DC2:  startsearch( st ); break; // Ctrl + R
+    }
+    return -1;
+}
 
-        case ESCAPE: {
-            if ( '[' == c ) {
-                st->state = BRACKET;
-                st->param = 0;
+/** Process a received byte of a multibyte UTF-8 character.
+  * The character is added to the line when its sequence is complete.
+  * Invalid sequences and C1 control characters are discarded.
+  * @param st State of line capture.
+  * @param c  The received byte. */
+static void addbyte( struct vt100state* st, int c ) {
+    st->mb[ st->mblen++ ] = c;
+    unsigned cp;
+    int len = utf8_decode( st->mb, st->mblen, &cp );
+    if( 0 == len && 1 < st->mblen ) { // It may start a new sequence
+        st->mb[0] = c;
+        st->mblen = 1;
+        len = utf8_decode( st->mb, st->mblen, &cp );
+    }
+    if( 0 > len )
+        return;
+    st->mblen = 0;
+    if( 0 == len || 0xA0 > cp )
+        return;
+    if( st->paste )
+        pastechars( st, st->mb, len );
+    else
+        addseq( st, st->mb, len );
+}
+
+/** Process a received character in a line capture without sending the output.
+  * @param st State of line capture.
+  * @param c  The received character.
+  * @retval  non-negative: The line is just captured. The value is the length.
+  * @retval negative:      Waiting for another character. */
+static int process( struct vt100state* st, int c ) {
+    if( 0x80 > c )
+        st->mblen = 0;
+    int const action = ecma48_parse( &st->esc, c );
+    if( 0 <= st->list && pager( st, action, c ) )
+        return -1;
+    if( 0 <= st->qlen && searchkey( st, action, c ) )
+        return -1;
+    if( ECMA48_NONE != action ) {
+        int const tab = ECMA48_EXECUTE == action && TAB == c;
+        if( !tab )
+            st->tabs = 0;
+        if( !tab && ( ECMA48_CSI != action || 'Z' != c ) ) // Nor Shift + Tab
+            st->patlen = -1;
+    }
+    switch( action ) {
+        case ECMA48_PRINT: {
+            if( 0x80 <= c )
+                addbyte( st, c );
+            else if( st->paste ) {
+                char const ch = c;
+                pastechars( st, &ch, 1 );
             }
-            else if ( 'O' == c )
-                st->state = BIG_O;
-            else
-                st->state = CHAR;
+            else if( ascii_is( c, ASCII_PRINT ) )
+                addchar( st, c );
+            break;
+        }
+        case ECMA48_EXECUTE: {
+            int const len = control( st, c );
+            if( 0 <= len )
+                return len;
             break;
         }
+        case ECMA48_CSI: csi( st, c ); break;
+        case ECMA48_SS3: ss3( st, c ); break;
+    }
+    if( !st->paste && 0 > st->list && 0 > st->qlen )
+        view( st );
+    return -1;
+}
 
-        case BRACKET: {
-            if( ';' == c ) {
-                st->param = 0;
-                break;
+/* Process a received character in a line capture. */
+int vt100_char( struct vt100state* st, int c ) {
+    int const len = process( st, c );
+    flush( st );
+    return len;
+}
+
+/* Process a buffer of received characters in a line capture. */
+int vt100_feed( struct vt100state* st, char const* buf, int len, int* consumed ) {
+    int rslt = -1;
+    int i = 0;
+    while( i < len ) {
+        int const ground = ecma48_ground( &st->esc ) && 0 == st->mblen && 0 > st->list && 0 > st->qlen;
+        if( ground && !st->paste && st->cur == st->len ) {
+            int const run = utf8_span( buf + i, len - i );
+            if( 0 != run ) {
+                append( st, buf + i, run );
+                st->tabs   = 0;
+                st->patlen = -1;
+                view( st );
+                i += run;
+                continue;
             }
-            if( !isdigit( c ) ) {
-                escapeSquareBracket( st, c );
-                st->state = CHAR;
-                break;
+        }
+        if( ground && st->paste ) {
+            int const run = utf8_span( buf + i, len - i );
+            if( 0 != run ) {
+                pastechars( st, buf + i, run );
+                i += run;
+                continue;
             }
-            st->param = 10 * st->param + c - '0';
-            break;
         }
-
-        case BIG_O: {
-            escapeBigO( st, c );
-            st->state = CHAR;
-            break;
+        int const skip = ecma48_skip( &st->esc, buf + i, len - i );
+        if( 0 != skip ) {
+            i += skip;
+            continue;
         }
-
+        rslt = process( st, (unsigned char)buf[i++] );
+        if( 0 <= rslt )
+            break;
     }
-    return -1;
+    flush( st );
+    if( NULL != consumed )
+        *consumed = i;
+    return rslt;
 }
@@ -27,24 +27,63 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
 #include "history.h"
-
-/** Set of hints for a line capture. */
-struct hints {
-    /** Pointer to array of null-terminated strings with the hints. */
-    char const* const* str;
-    /** Number of hints. */
-    int qty;
-};
+#include "hints.h"
+#include "hintshare.h"
+#include "ecma48.h"
+#include "utf8.h"
 
 /** Configuration to capture a line from a vt100 terminal */
 struct vt100 {
-    /** A valid instance of a terminal. It will be passed to tputc() and tputs() */
+    /** A valid instance of a terminal. It will be passed to tputn(). */
     void* p;
     struct history* hist;       /**< History handle or null if there is not. */
     struct hints const* hints;  /**< Hints handle or null if there is not.   */
     char* line;                 /**< Destination buffer.                     */
     int max;                    /**< Size of line buffer.                    */
+    /** Columns of the terminal available for the line or zero for no limit.
+      * If it is set, lines wider than the terminal are scrolled horizontally. */
+    int cols;
+    /** Rows of the terminal or zero if they are unknown. If they are set,
+      * a second Tab lists the matching hints a page at a time instead of
+      * cycling through them. */
+    int rows;
+    /** Function to get the hints that start with a prefix or null to use the
+      * hints set. It returns an array of candidates and sets its length.
+      * The candidates that do not start with the prefix are discarded. The
+      * array and its strings belong to the user project and they must be
+      * valid until the line is captured. The array is reordered to narrow
+      * it while the line grows, so the function is not called on each Tab.
+      * With the fuzzy search it is called with an empty prefix to get all
+      * the candidates, which are scored with the characters typed.
+      * @param p   The terminal instance of the configuration.
+      * @param str The prefix. It is not null-terminated.
+      * @param len Length of the prefix.
+      * @param qty Destination of the number of candidates.
+      * @return The array of candidates or null if there are not. */
+    char const** (*provider)( void* p, char const* str, int len, int* qty );
+    /** Hints set shared with other line captures or null if there is not.
+      * If it is set, it is used instead of the field hints. Each line keeps
+      * the snapshot of its first Tab until it is captured or discarded. */
+    struct hintshare* share;
+    /** Completion tree or null if there is not. If it is set, the word under
+      * the cursor is completed with the hints of its position in the command
+      * line instead of the whole line with the hints set, see hints_tree(). */
+    struct hintnode const* tree;
+    /** Non-zero to search the hints set with fuzzy matching. Then Tab writes
+      * the hints that have the characters before the cursor in the same
+      * order, from the best match to the worst, see hints_fuzzynext(). It
+      * searches the candidates of the provider if it is set. */
+    int fuzzy;
+    /** Prompt printed before the line or null. It is sent again when the
+      * line is drawn below a listing of hints. */
+    char const* prompt;
+    /** Function to enlarge the line buffer or null if it has a fixed size.
+      * It has the same semantics as realloc(). If it is set, the line buffer
+      * must be compatible with it and the captured line is in the line
+      * buffer of the state of line capture, see vt100_read(). */
+    void* (*grow)( void* line, size_t size );
 };
 
 /** Echo mode. */
@@ -54,16 +93,55 @@ enum echo {
     echo_pass
 };
 
+#ifndef VT100_TXSIZE
+/** Size of the output buffer of each line capture.
+  * All the output generated by a received character is collected in it and
+  * sent with tputn(). It is flushed earlier only when it gets full. */
+#define VT100_TXSIZE 128
+#endif
+
+#ifndef VT100_QUERYMAX
+/** Maximum length of the query of a reverse incremental search. */
+#define VT100_QUERYMAX 32
+#endif
+
 /** State of line capture. For internal use. */
 struct vt100state {
     struct vt100 const* cfg;
+    char tx[ VT100_TXSIZE ]; /**< Output buffer.        */
+    short txlen;             /**< Length of the output. */
+    char* line;  /**< Line buffer.                 */
+    int max;     /**< Size of line buffer.         */
+    struct ecma48 esc; /**< Escape sequence parser. */
     short echo;  /**< Echo mode.                   */
-    short state; /**< For state machine.           */
-    short param; /**< Parameter of vt100 commands. */
-    short len;   /**< Actual line len.             */
-    short cur;   /**< Actual cursor possition.     */
-    short h;     /**< Hint index.                  */
+    short paste; /**< Bracketed paste in progress. */
+    int len;     /**< Actual line len.             */
+    int cur;     /**< Actual cursor possition.     */
+    int off;     /**< First position shown.        */
+    int col;     /**< Terminal cursor column.      */
+    int h;       /**< Hint index.                  */
+    int mark;    /**< Cursor at paste start.       */
     short fh;    /**< First history request.       */
+    short tabs;  /**< Consecutive Tabs that did not complete. */
+    int list;     /**< Next hint listed or -1 if not listing. */
+    int listleft; /**< Number of hints left to list.          */
+    short listw;  /**< Width of the columns of the listing.   */
+    struct hints const* hints; /**< Hints set of the last Tab.      */
+    int word;                  /**< Start of the word completed.    */
+    struct hintsnap* snap;     /**< Snapshot of the shared hints.   */
+    char const** cands;        /**< Candidates of the provider.     */
+    int candlen;               /**< Prefix length of the candidates. */
+    struct hints provided;     /**< Hints set of the candidates.    */
+    short patlen;                       /**< Length of the fuzzy pattern or -1. */
+    char pattern[ HINTS_FUZZYMAX ];     /**< Pattern of the fuzzy search.       */
+    short qlen;                   /**< Length of the search query or -1.  */
+    char query[ VT100_QUERYMAX ]; /**< Query of the reverse search.       */
+    char const* found;            /**< Entry found by the search or null. */
+    int foundat;                  /**< Position of the match in it.       */
+    int nonascii;        /**< Non-ASCII bytes in the line. */
+    short mblen;         /**< Length of partial UTF-8.     */
+    char mb[ UTF8_MAX ]; /**< Partial UTF-8 sequence.      */
+    struct utf8_cache widths; /**< Cache of display widths. */
 };
 
 /** Initialize a state of line capture.
@@ -71,6 +149,18 @@ struct vt100state {
   * @param vt100 Configuration of line capture. */
 void vt100_init( struct vt100state* st, struct vt100 const* vt100, enum echo echo );
 
+/** Start a session of line captures in a terminal.
+  * It enables the bracketed paste mode, so the terminal sends the pasted
+  * text between <ESC>[200~ and <ESC>[201~. Call it once, before the first
+  * line capture, and call vt100_stop() when the session ends.
+  * @param vt100 Configuration of line capture. */
+void vt100_start( struct vt100 const* vt100 );
+
+/** End a session of line captures in a terminal.
+  * It disables the bracketed paste mode, so the terminal is left as it was.
+  * @param vt100 Configuration of line capture. */
+void vt100_stop( struct vt100 const* vt100 );
+
 /** Process a received character in a line capture.
   * @param st State of line capture.
   * @param c  The received character.
@@ -78,7 +168,21 @@ void vt100_init( struct vt100state* st, struct vt100 const* vt100, enum echo ech
   * @retval negative:      Waiting for another character. */
 int vt100_char( struct vt100state* st, int c );
 
+/** Process a buffer of received characters in a line capture.
+  * It stops just after the character that completes a line, so the rest of
+  * the buffer can be passed in the next call. Runs of printable characters
+  * at the end of the line are copied and echoed at once.
+  * @param st       State of line capture.
+  * @param buf      The received characters.
+  * @param len      Number of received characters.
+  * @param consumed If not null, it is set with the number of characters used.
+  * @retval  non-negative: The line is just captured. The value is the length.
+  * @retval negative:      All characters were used and no line is completed. */
+int vt100_feed( struct vt100state* st, char const* buf, int len, int* consumed );
+
 /** Discard all received and star a new line capture.
+  * It also releases the snapshot of the shared hints set, so it has to be
+  * called when a line capture is abandoned.
   * @param st State of line capture. */
 void vt100_newline( struct vt100state* st );
 
@@ -89,6 +193,15 @@ void vt100_newline( struct vt100state* st );
   * @retval On error, a negative value returned by tgetc(). */
 int vt100_getline( struct vt100 const* vt100, enum echo echo );
 
+/** Get blocked until capture a line with a state of line capture.
+  * It can be used only if the tgetc function is defined.
+  * The state keeps the line buffer between calls, so it has to be used
+  * instead of vt100_getline() when the line buffer can grow.
+  * @param st State of line capture. The line captured is in st->line.
+  * @retval On success, a non negative with the length of the line captured.
+  * @retval On error, a negative value returned by tgetc(). */
+int vt100_read( struct vt100state* st );
+
 #ifdef	__cplusplus
 }
 #endif